@@ -0,0 +1,243 @@
+#ifndef AD_EX_ARENA_HPP
+#define AD_EX_ARENA_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <vector>
+
+namespace ad {
+
+/**
+ * Bump allocator for the autodiff tape.
+ *
+ * Memory is handed out from a list of chunks. When the current chunk is
+ * exhausted the arena moves on to the next chunk, allocating a new one twice
+ * the size of the last if none is left. `recover()` rewinds to the first chunk
+ * but keeps every chunk around, so once the arena has seen the peak size of a
+ * gradient evaluation later evaluations never touch the system allocator.
+ *
+ * Deallocation is a no-op, as with `std::pmr::monotonic_buffer_resource`.
+ */
+class arena_resource final : public std::pmr::memory_resource {
+ public:
+  /**
+   * Alignment of every chunk handed to the arena.
+   */
+  static constexpr std::size_t chunk_alignment = 64;
+
+  /**
+   * Construct an arena whose first chunk is `initial_size` bytes.
+   * @param initial_size size in bytes of the first chunk
+   */
+  explicit arena_resource(std::size_t initial_size = 1 << 16) {
+    add_chunk(std::max<std::size_t>(initial_size, chunk_alignment));
+    set_chunk(0);
+  }
+
+  /**
+   * Construct an arena whose first chunk is caller owned memory. The buffer is
+   * never freed by the arena and must outlive it.
+   * @param buffer pointer to the start of the buffer
+   * @param size size of the buffer in bytes
+   */
+  arena_resource(void* buffer, std::size_t size) {
+    chunks_.push_back({static_cast<std::byte*>(buffer), size, false});
+    set_chunk(0);
+  }
+
+  /**
+   * A position in the arena that can be rewound to.
+   */
+  struct mark {
+    std::size_t chunk_;
+    std::byte* next_;
+    std::size_t used_before_;
+  };
+
+  arena_resource(const arena_resource&) = delete;
+  arena_resource& operator=(const arena_resource&) = delete;
+
+  ~arena_resource() override { free_chunks(); }
+
+  /**
+   * Rewind the arena to the start of the first chunk. All chunks are kept for
+   * reuse by the next gradient evaluation.
+   */
+  inline void recover() noexcept {
+    peak_ = std::max(peak_, bytes_used());
+    set_chunk(0);
+  }
+
+  /**
+   * @return the current position of the arena
+   */
+  inline mark get_mark() const noexcept { return {cur_, next_, used_before_}; }
+
+  /**
+   * Rewind the arena to a mark taken earlier. Everything allocated after the
+   * mark is reused by later allocations.
+   * @param m mark returned by `get_mark()`
+   */
+  inline void rewind(const mark& m) noexcept {
+    peak_ = std::max(peak_, bytes_used());
+    cur_ = m.chunk_;
+    next_ = m.next_;
+    end_ = chunks_[cur_].data_ + chunks_[cur_].size_;
+    used_before_ = m.used_before_;
+  }
+
+  /**
+   * Rewind the arena and hand every chunk except the first back to the system
+   * allocator.
+   */
+  inline void release() noexcept {
+    peak_ = std::max(peak_, bytes_used());
+    auto first = chunks_.front();
+    chunks_.erase(chunks_.begin());
+    free_chunks();
+    chunks_.assign(1, first);
+    set_chunk(0);
+  }
+
+  /**
+   * Make sure the chunks held by the arena can fit at least `bytes` bytes
+   * without allocating. Passing `peak_bytes()` from a previous evaluation
+   * pre-sizes the arena for the next one.
+   * @param bytes number of bytes to reserve
+   */
+  inline void reserve(std::size_t bytes) {
+    const std::size_t cap = capacity();
+    if (cap < bytes) {
+      add_chunk(std::max(bytes - cap, chunks_.back().size_ * 2));
+    }
+  }
+
+  /**
+   * @return number of bytes handed out since the last `recover()`
+   */
+  inline std::size_t bytes_used() const noexcept {
+    return used_before_ + static_cast<std::size_t>(next_ - chunks_[cur_].data_);
+  }
+
+  /**
+   * @return largest number of bytes in use at any one time
+   */
+  inline std::size_t peak_bytes() const noexcept {
+    return std::max(peak_, bytes_used());
+  }
+
+  /**
+   * @return total size in bytes of all chunks held by the arena
+   */
+  inline std::size_t capacity() const noexcept {
+    std::size_t cap = 0;
+    for (auto&& chunk : chunks_) {
+      cap += chunk.size_;
+    }
+    return cap;
+  }
+
+  /**
+   * @return number of chunks held by the arena
+   */
+  inline std::size_t num_chunks() const noexcept { return chunks_.size(); }
+
+  /**
+   * @return number of chunks ever requested from the system allocator,
+   *  including ones since freed by `release()`. A caller owned first chunk
+   *  is not counted, so anything above zero for an arena built on a buffer
+   *  means the buffer overflowed.
+   */
+  inline std::size_t upstream_allocations() const noexcept {
+    return upstream_allocations_;
+  }
+
+ protected:
+  inline void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+    auto* ret = align_up(next_, alignment);
+    // Chunk ends need not be aligned, so the padding alone can pass `end_`.
+    if (ret > end_ || bytes > static_cast<std::size_t>(end_ - ret)) [[unlikely]] {
+      ret = next_chunk(bytes, alignment);
+    }
+    next_ = ret + bytes;
+    return ret;
+  }
+
+  inline void do_deallocate(void*, std::size_t, std::size_t) override {}
+
+  inline bool do_is_equal(
+      const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+
+ private:
+  struct chunk {
+    std::byte* data_;
+    std::size_t size_;
+    bool owned_;
+  };
+
+  static inline std::byte* align_up(std::byte* p, std::size_t alignment) {
+    auto addr = reinterpret_cast<std::uintptr_t>(p);
+    return p + ((alignment - addr % alignment) % alignment);
+  }
+
+  inline void add_chunk(std::size_t size) {
+    auto* data = static_cast<std::byte*>(
+        ::operator new(size, std::align_val_t{chunk_alignment}));
+    chunks_.push_back({data, size, true});
+    ++upstream_allocations_;
+  }
+
+  inline void set_chunk(std::size_t i) noexcept {
+    if (i == 0) {
+      used_before_ = 0;
+    } else {
+      used_before_ += static_cast<std::size_t>(next_ - chunks_[cur_].data_);
+    }
+    cur_ = i;
+    next_ = chunks_[i].data_;
+    end_ = chunks_[i].data_ + chunks_[i].size_;
+  }
+
+  /**
+   * Move to the first following chunk that can hold the allocation, growing
+   * the arena if there is none.
+   */
+  std::byte* next_chunk(std::size_t bytes, std::size_t alignment) {
+    const std::size_t needed = bytes + alignment;
+    std::size_t i = cur_ + 1;
+    while (i < chunks_.size() && chunks_[i].size_ < needed) {
+      ++i;
+    }
+    if (i == chunks_.size()) {
+      add_chunk(std::max(needed, chunks_.back().size_ * 2));
+    }
+    set_chunk(i);
+    return align_up(next_, alignment);
+  }
+
+  inline void free_chunks() noexcept {
+    for (auto&& chunk : chunks_) {
+      if (chunk.owned_) {
+        ::operator delete(chunk.data_, std::align_val_t{chunk_alignment});
+      }
+    }
+    chunks_.clear();
+  }
+
+  std::vector<chunk> chunks_;
+  std::size_t cur_{0};
+  std::byte* next_{nullptr};
+  std::byte* end_{nullptr};
+  std::size_t used_before_{0};
+  std::size_t peak_{0};
+  std::size_t upstream_allocations_{0};
+};
+
+}  // namespace ad
+
+#endif
@@ -3,14 +3,41 @@
 
 #include <ad_ex/meta/is_eigen.hpp>
 #include <ad_ex/eigen_numtraits.hpp>
+#include <cstddef>
+
+/**
+ * Alignment in bytes of the storage of every `arena_matrix`. At 64 each
+ * matrix starts on a cache line and Eigen is told its packets are aligned,
+ * so the forward and reverse kernels use aligned loads and stores. Set it to
+ * 16, the arena's default, to compare against unaligned maps.
+ */
+#ifndef AD_ARENA_MATRIX_ALIGNMENT
+#define AD_ARENA_MATRIX_ALIGNMENT 64
+#endif
 
 namespace ad {
 
+inline constexpr std::size_t arena_matrix_alignment = AD_ARENA_MATRIX_ALIGNMENT;
+
+namespace detail {
+/**
+ * The `Eigen::Map` alignment option promised by `arena_matrix_alignment`.
+ */
+inline constexpr int arena_map_options
+    = arena_matrix_alignment >= 64   ? Eigen::Aligned64
+      : arena_matrix_alignment >= 32 ? Eigen::Aligned32
+      : arena_matrix_alignment >= 16 ? Eigen::Aligned16
+                                     : Eigen::Unaligned;
+}  // namespace detail
+
+template <typename MatrixType>
+using arena_map_t = Eigen::Map<std::decay_t<MatrixType>, detail::arena_map_options>;
+
 template <EigenMatrix MatrixType>
-class arena_matrix : public Eigen::Map<std::decay_t<MatrixType>> {
+class arena_matrix : public arena_map_t<MatrixType> {
  public:
   using Scalar = typename std::decay_t<MatrixType>::Scalar;
-  using Base = Eigen::Map<std::decay_t<MatrixType>>;
+  using Base = arena_map_t<MatrixType>;
   using PlainObject = std::decay_t<MatrixType>;
   static constexpr int RowsAtCompileTime = MatrixType::RowsAtCompileTime;
   static constexpr int ColsAtCompileTime = MatrixType::ColsAtCompileTime;
@@ -24,15 +51,21 @@ class arena_matrix : public Eigen::Map<std::decay_t<MatrixType>> {
                   ColsAtCompileTime == Eigen::Dynamic ? 0 : ColsAtCompileTime) {
   }
 
+  /**
+   * Storage for `n` coefficients on the tape's arena.
+   */
+  static inline Scalar* allocate(Eigen::Index n) {
+    return static_cast<Scalar*>(get_tape().pa_.allocate_bytes(
+        sizeof(Scalar) * n, arena_matrix_alignment));
+  }
+
   /**
    * Constructs `arena_matrix` with given number of rows and columns.
    * @param rows number of rows
    * @param cols number of columns
    */
   arena_matrix(Eigen::Index rows, Eigen::Index cols)
-      : Base::Map(
-          (Scalar*)pa.allocate_bytes(sizeof(Scalar) * rows * cols),
-          rows, cols) {}
+      : Base::Map(allocate(rows * cols), rows, cols) {}
 
   /**
    * Constructs `arena_matrix` with given size. This only works if
@@ -40,9 +73,7 @@ class arena_matrix : public Eigen::Map<std::decay_t<MatrixType>> {
    * @param size number of elements
    */
   explicit arena_matrix(Eigen::Index size)
-      : Base::Map(
-          (Scalar*)pa.allocate_bytes(sizeof(Scalar) * size),
-          size) {}
+      : Base::Map(allocate(size), size) {}
 
  private:
   template <typename T>
@@ -67,10 +98,8 @@ class arena_matrix : public Eigen::Map<std::decay_t<MatrixType>> {
    */
   template <typename T>
   arena_matrix(const T& other)  // NOLINT
-      : Base::Map((Scalar*)pa.allocate_bytes(sizeof(Scalar) *
-                      other.size()),
-                  get_rows(other), get_cols(other)) {
-    *this = other;
+      : Base::Map(allocate(other.size()), get_rows(other), get_cols(other)) {
+    Base::operator=(other);
   }
   /**
    * Overwrite the current arena_matrix with new memory and assign a matrix to
@@ -81,8 +110,7 @@ class arena_matrix : public Eigen::Map<std::decay_t<MatrixType>> {
   template <EigenMatrix T>
   arena_matrix& operator=(const T& other) {
     new (this) Base(
-        (Scalar*)pa.allocate_bytes(sizeof(Scalar) * other.size()),
-        get_rows(other), get_cols(other));
+        allocate(other.size()), get_rows(other), get_cols(other));
     Base::operator=(other);
     return *this;
   }
@@ -90,7 +118,8 @@ class arena_matrix : public Eigen::Map<std::decay_t<MatrixType>> {
 
   /**
    * Constructs `arena_matrix` from an expression. This makes an assumption that
-   * any other `Eigen::Map` also contains memory allocated in the arena.
+   * any other map with the arena's alignment also contains memory allocated
+   * in the arena.
    * @param other expression
    */
   arena_matrix(const Base& other)  // NOLINT
@@ -138,7 +167,7 @@ namespace internal {
 
 template <typename T>
 struct traits<ad::arena_matrix<T>> {
-  using base = traits<Eigen::Map<T>>;
+  using base = traits<ad::arena_map_t<T>>;
   using Scalar = typename base::Scalar;
   using XprKind = typename Eigen::internal::traits<std::decay_t<T>>::XprKind;
   using StorageKind = typename Eigen::internal::traits<std::decay_t<T>>::StorageKind;
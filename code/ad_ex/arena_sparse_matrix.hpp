@@ -0,0 +1,111 @@
+#ifndef AD_EX_ARENA_SPARSE_MATRIX_HPP
+#define AD_EX_ARENA_SPARSE_MATRIX_HPP
+
+#include <ad_ex/meta/Eigen.hpp>
+#include <ad_ex/arena_matrix.hpp>
+#include <ad_ex/tape.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+namespace ad {
+
+/**
+ * Eigen sparse matrix or sparse expression.
+ */
+template <typename T>
+concept SparseMatrixType
+    = std::is_base_of_v<Eigen::SparseMatrixBase<std::decay_t<T>>, std::decay_t<T>>;
+
+/**
+ * A compressed sparse matrix whose index arrays and values all live on the
+ * tape's arena, the sparse counterpart of `arena_matrix`.
+ *
+ * Matrices made with `zeros_like()` share the index arrays of another, so
+ * the adjoint of a sparse var stores exactly the nonzeros of its value and
+ * the two can be walked together.
+ * @tparam MatrixType an `Eigen::SparseMatrix`
+ */
+template <typename MatrixType>
+class arena_sparse_matrix : public Eigen::Map<std::decay_t<MatrixType>> {
+ public:
+  using PlainObject = std::decay_t<MatrixType>;
+  using Base = Eigen::Map<PlainObject>;
+  using Scalar = typename PlainObject::Scalar;
+  using StorageIndex = typename PlainObject::StorageIndex;
+
+  /**
+   * Copies a sparse matrix or expression into the arena. The copy is always
+   * compressed.
+   * @param other sparse matrix or expression
+   */
+  template <SparseMatrixType T>
+  arena_sparse_matrix(const T& other)  // NOLINT
+      : Base(0, 0, 0, nullptr, nullptr, nullptr) {
+    if constexpr (std::is_same_v<T, PlainObject>) {
+      if (other.isCompressed()) {
+        copy_from(other);
+        return;
+      }
+    }
+    PlainObject x(other);
+    x.makeCompressed();
+    copy_from(x);
+  }
+
+  /**
+   * Copy constructor, shares the storage of `other`.
+   * @param other matrix to copy from
+   */
+  arena_sparse_matrix(const arena_sparse_matrix& other)
+      : Base(other.rows(), other.cols(), other.nonZeros(),
+             const_cast<StorageIndex*>(other.outerIndexPtr()),
+             const_cast<StorageIndex*>(other.innerIndexPtr()),
+             const_cast<Scalar*>(other.valuePtr())) {}
+
+  /**
+   * @param pattern matrix whose index arrays are shared
+   * @return a matrix with the sparsity pattern of `pattern` and new values,
+   *  all zero
+   */
+  static inline arena_sparse_matrix zeros_like(const arena_sparse_matrix& pattern) {
+    Scalar* values = allocate<Scalar>(pattern.nonZeros(), arena_matrix_alignment);
+    std::fill_n(values, pattern.nonZeros(), Scalar(0));
+    return arena_sparse_matrix(pattern.rows(), pattern.cols(), pattern.nonZeros(),
+                               const_cast<StorageIndex*>(pattern.outerIndexPtr()),
+                               const_cast<StorageIndex*>(pattern.innerIndexPtr()),
+                               values);
+  }
+
+ private:
+  arena_sparse_matrix(Eigen::Index rows, Eigen::Index cols, Eigen::Index nnz,
+                      StorageIndex* outer, StorageIndex* inner, Scalar* values)
+      : Base(rows, cols, nnz, outer, inner, values) {}
+
+  /**
+   * Points this map at an arena copy of the compressed matrix `x`.
+   */
+  inline void copy_from(const PlainObject& x) {
+    new (this) Base(
+        x.rows(), x.cols(), x.nonZeros(),
+        copy(x.outerIndexPtr(), x.outerSize() + 1, alignof(StorageIndex)),
+        copy(x.innerIndexPtr(), x.nonZeros(), alignof(StorageIndex)),
+        copy(x.valuePtr(), x.nonZeros(), arena_matrix_alignment));
+  }
+
+  template <typename S>
+  static inline S* allocate(Eigen::Index n, std::size_t alignment) {
+    return static_cast<S*>(
+        get_tape().pa_.allocate_bytes(sizeof(S) * n, alignment));
+  }
+
+  template <typename S>
+  static inline S* copy(const S* x, Eigen::Index n, std::size_t alignment) {
+    S* ret = allocate<S>(n, alignment);
+    std::copy_n(x, n, ret);
+    return ret;
+  }
+};
+
+}  // namespace ad
+#endif
@@ -0,0 +1,145 @@
+#ifndef AD_EX_BACKENDS_HPP
+#define AD_EX_BACKENDS_HPP
+
+#include <ad_ex/fvar.hpp>
+#include <ad_ex/lambda.hpp>
+#include <ad_ex/models.hpp>
+#include <ad_ex/soa_replay.hpp>
+#include <ad_ex/soa_tape.hpp>
+#include <concepts>
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include <vector>
+
+/**
+ * The AD implementations of `ad_ex` behind one interface, so the models in
+ * `models.hpp` are written once and run on each of them.
+ *
+ * A backend is made once per model and then asked for the value and
+ * gradient of the model's log density at a point, as a sampler or optimizer
+ * would. Backends that keep state between calls, like a recorded tape, set
+ * it up in their constructor.
+ */
+namespace ad::models {
+
+template <typename B, typename M>
+concept backend = model<M> && std::constructible_from<B, const M&>
+                  && requires(B b, std::span<const double> x,
+                              std::span<double> g) {
+                       { B::name } -> std::convertible_to<std::string_view>;
+                       { b.gradient(x, g) } -> std::same_as<double>;
+                     };
+
+/**
+ * The model's hand written double gradient, the roofline for the others.
+ */
+template <model M>
+struct baseline_backend {
+  static constexpr std::string_view name = "baseline";
+  const M& m_;
+  explicit baseline_backend(const M& m) : m_(m) {}
+  inline double gradient(std::span<const double> x, std::span<double> g) {
+    return m_.gradient(x, g);
+  }
+};
+
+/**
+ * Reverse mode with the closure nodes of `lambda.hpp`, recorded again on
+ * every call.
+ */
+template <model M>
+struct lambda_backend {
+  static constexpr std::string_view name = "lambda";
+  const M& m_;
+  std::vector<var> x_;
+  explicit lambda_backend(const M& m) : m_(m) { x_.reserve(m.dims()); }
+  inline double gradient(std::span<const double> x, std::span<double> g) {
+    clear_mem();
+    x_.clear();
+    for (double xi : x) {
+      x_.emplace_back(xi);
+    }
+    var lp = m_(x_);
+    grad(lp);
+    for (std::size_t i = 0; i < x_.size(); ++i) {
+      g[i] = x_[i].adj();
+    }
+    return lp.val();
+  }
+};
+
+/**
+ * Reverse mode on the structure of arrays tape of `soa_tape.hpp`, recorded
+ * again on every call.
+ */
+template <model M>
+struct soa_backend {
+  static constexpr std::string_view name = "soa";
+  const M& m_;
+  std::vector<soa::var> x_;
+  explicit soa_backend(const M& m) : m_(m) { x_.reserve(m.dims()); }
+  inline double gradient(std::span<const double> x, std::span<double> g) {
+    soa::clear_mem();
+    x_.clear();
+    for (double xi : x) {
+      x_.emplace_back(xi);
+    }
+    soa::var lp = m_(x_);
+    soa::grad(lp);
+    for (std::size_t i = 0; i < x_.size(); ++i) {
+      g[i] = x_[i].adj();
+    }
+    return lp.val();
+  }
+};
+
+/**
+ * The `soa` tape recorded once and replayed for every call, see
+ * `soa_replay.hpp`. Valid for these models since none of them branch on
+ * parameter values.
+ */
+template <model M>
+struct soa_replay_backend {
+  static constexpr std::string_view name = "soa_replay";
+  struct log_density {
+    const M* m_;
+    inline soa::var operator()(const std::vector<soa::var>& x) const {
+      return (*m_)(x);
+    }
+  };
+  soa::recorded_function<log_density> f_;
+  explicit soa_replay_backend(const M& m) : f_(log_density{&m}) {}
+  inline double gradient(std::span<const double> x, std::span<double> g) {
+    return f_.gradient(x, g);
+  }
+};
+
+/**
+ * Forward mode with `fvar<double>`, one sweep per parameter.
+ */
+template <model M>
+struct fvar_backend {
+  static constexpr std::string_view name = "fvar";
+  const M& m_;
+  std::vector<fvar<double>> x_;
+  explicit fvar_backend(const M& m) : m_(m), x_(m.dims()) {}
+  inline double gradient(std::span<const double> x, std::span<double> g) {
+    double lp = 0;
+    for (std::size_t i = 0; i < x.size(); ++i) {
+      x_[i] = fvar<double>(x[i]);
+    }
+    for (std::size_t i = 0; i < x.size(); ++i) {
+      x_[i].d_ = 1.0;
+      const fvar<double> fx = m_(x_);
+      x_[i].d_ = 0.0;
+      g[i] = fx.d_;
+      lp = fx.value_;
+    }
+    return lp;
+  }
+};
+
+}  // namespace ad::models
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef AD_EX_FUNCTIONAL_HPP
+#define AD_EX_FUNCTIONAL_HPP
+
+#include <ad_ex/meta/Eigen.hpp>
+#include <ad_ex/lambda.hpp>
+#include <ad_ex/eigen_numtraits.hpp>
+#include <ad_ex/fvar.hpp>
+#include <ad_ex/fvar_numtraits.hpp>
+
+namespace ad {
+
+/**
+ * Compute the value and gradient of `f` at `x` with reverse mode. Runs in a
+ * nested region, so nothing is left on the tape afterwards.
+ * @tparam F callable taking an `Eigen::Matrix<var, -1, 1>` and returning a
+ *  `var`
+ * @param f function to differentiate
+ * @param x point to evaluate at
+ * @param[out] fx value of `f` at `x`
+ * @param[out] grad_fx gradient of `f` at `x`
+ */
+template <typename F>
+inline void gradient(const F& f, const Eigen::VectorXd& x, double& fx,
+                     Eigen::VectorXd& grad_fx) {
+  nested_rev_autodiff nested;
+  Eigen::Matrix<var, -1, 1> x_var(x.size());
+  for (Eigen::Index i = 0; i < x.size(); ++i) {
+    x_var(i) = var(x(i));
+  }
+  var fx_var = f(x_var);
+  fx = fx_var.val();
+  grad(fx_var);
+  grad_fx.resize(x.size());
+  for (Eigen::Index i = 0; i < x.size(); ++i) {
+    grad_fx(i) = x_var(i).adj();
+  }
+}
+
+/**
+ * Compute the Hessian of `f` at `x` times `v` by forward over reverse mode.
+ *
+ * `f` is evaluated once on `fvar<var>` inputs whose tangents are `v`, so the
+ * tangent of the result is the directional derivative grad(f)' v recorded on
+ * the tape. One reverse sweep from it then gives H v, at the cost of a
+ * few gradients rather than one gradient per input.
+ * @tparam F callable taking an `Eigen::Matrix<fvar<var>, -1, 1>` and
+ *  returning an `fvar<var>`
+ * @param f function to differentiate
+ * @param x point to evaluate at
+ * @param v vector to multiply the Hessian with
+ * @param[out] fx value of `f` at `x`
+ * @param[out] hv Hessian of `f` at `x` times `v`
+ */
+template <typename F>
+inline void hessian_times_vector(const F& f, const Eigen::VectorXd& x,
+                                 const Eigen::VectorXd& v, double& fx,
+                                 Eigen::VectorXd& hv) {
+  nested_rev_autodiff nested;
+  Eigen::Matrix<fvar<var>, -1, 1> x_fvar(x.size());
+  for (Eigen::Index i = 0; i < x.size(); ++i) {
+    x_fvar(i) = fvar<var>(var(x(i)), var(v(i)));
+  }
+  fvar<var> fx_fvar = f(x_fvar);
+  fx = fx_fvar.value_.val();
+  grad(fx_fvar.d_);
+  hv.resize(x.size());
+  for (Eigen::Index i = 0; i < x.size(); ++i) {
+    hv(i) = x_fvar(i).value_.adj();
+  }
+}
+
+}  // namespace ad
+#endif
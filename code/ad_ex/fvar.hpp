@@ -0,0 +1,222 @@
+#ifndef AD_EX_FVAR_HPP
+#define AD_EX_FVAR_HPP
+
+#include <cmath>
+#include <concepts>
+#include <type_traits>
+
+namespace ad {
+
+/**
+ * Forward mode dual number holding a value and its directional derivative
+ * (tangent).
+ *
+ * The value and tangent can be any scalar with the usual arithmetic and math
+ * functions, so `fvar<double>` is plain forward mode and `fvar<var>` records
+ * the forward sweep on the reverse mode tape. Differentiating the tangent of
+ * an `fvar<var>` result in reverse mode gives a Hessian-vector product, see
+ * `hessian_times_vector()`.
+ *
+ * The members are named `value_` and `d_` so the Eigen plugins' `val()`
+ * recognize it.
+ * @tparam T type of the value and tangent
+ */
+template <typename T>
+struct fvar {
+  using value_type = T;
+  T value_;
+  T d_;
+
+  fvar() : value_(0), d_(0) {}
+
+  /**
+   * Construct a constant, i.e. a dual number with zero tangent.
+   * @param x value
+   */
+  template <typename V>
+  requires std::constructible_from<T, const V&>
+  fvar(const V& x) : value_(x), d_(0) {}
+
+  /**
+   * @param x value
+   * @param d tangent
+   */
+  template <typename V, typename D>
+  requires std::constructible_from<T, const V&>
+           && std::constructible_from<T, const D&>
+  fvar(const V& x, const D& d) : value_(x), d_(d) {}
+
+  inline const T& val() const { return value_; }
+  inline const T& tangent() const { return d_; }
+
+  inline fvar& operator+=(const fvar& x);
+  inline fvar& operator-=(const fvar& x);
+  inline fvar& operator*=(const fvar& x);
+  inline fvar& operator/=(const fvar& x);
+};
+
+namespace detail {
+template <typename T>
+struct is_fvar : std::false_type {};
+template <typename T>
+struct is_fvar<fvar<T>> : std::true_type {};
+}  // namespace detail
+
+template <typename T>
+inline constexpr bool is_fvar_v = detail::is_fvar<std::remove_cvref_t<T>>::value;
+
+template <typename T>
+concept Fvar = is_fvar_v<T>;
+
+/**
+ * Scalars an `fvar<T>` can be combined with: arithmetic types and `T` itself.
+ */
+template <typename S, typename T>
+concept fvar_operand
+    = std::is_arithmetic_v<std::remove_cvref_t<S>>
+      || std::is_same_v<std::remove_cvref_t<S>, T>;
+
+template <typename T>
+inline fvar<T> operator+(const fvar<T>& x, const fvar<T>& y) {
+  return {x.value_ + y.value_, x.d_ + y.d_};
+}
+template <typename T, fvar_operand<T> S>
+inline fvar<T> operator+(const fvar<T>& x, const S& y) {
+  return {x.value_ + y, x.d_};
+}
+template <typename T, fvar_operand<T> S>
+inline fvar<T> operator+(const S& x, const fvar<T>& y) {
+  return {x + y.value_, y.d_};
+}
+
+template <typename T>
+inline fvar<T> operator-(const fvar<T>& x, const fvar<T>& y) {
+  return {x.value_ - y.value_, x.d_ - y.d_};
+}
+template <typename T, fvar_operand<T> S>
+inline fvar<T> operator-(const fvar<T>& x, const S& y) {
+  return {x.value_ - y, x.d_};
+}
+template <typename T, fvar_operand<T> S>
+inline fvar<T> operator-(const S& x, const fvar<T>& y) {
+  return {x - y.value_, -y.d_};
+}
+template <typename T>
+inline fvar<T> operator-(const fvar<T>& x) {
+  return {-x.value_, -x.d_};
+}
+
+template <typename T>
+inline fvar<T> operator*(const fvar<T>& x, const fvar<T>& y) {
+  return {x.value_ * y.value_, x.d_ * y.value_ + x.value_ * y.d_};
+}
+template <typename T, fvar_operand<T> S>
+inline fvar<T> operator*(const fvar<T>& x, const S& y) {
+  return {x.value_ * y, x.d_ * y};
+}
+template <typename T, fvar_operand<T> S>
+inline fvar<T> operator*(const S& x, const fvar<T>& y) {
+  return {x * y.value_, x * y.d_};
+}
+
+template <typename T>
+inline fvar<T> operator/(const fvar<T>& x, const fvar<T>& y) {
+  T q = x.value_ / y.value_;
+  return {q, (x.d_ - q * y.d_) / y.value_};
+}
+template <typename T, fvar_operand<T> S>
+inline fvar<T> operator/(const fvar<T>& x, const S& y) {
+  return {x.value_ / y, x.d_ / y};
+}
+template <typename T, fvar_operand<T> S>
+inline fvar<T> operator/(const S& x, const fvar<T>& y) {
+  T q = x / y.value_;
+  return {q, -(q * y.d_) / y.value_};
+}
+
+template <typename T>
+inline fvar<T>& fvar<T>::operator+=(const fvar<T>& x) {
+  return *this = *this + x;
+}
+template <typename T>
+inline fvar<T>& fvar<T>::operator-=(const fvar<T>& x) {
+  return *this = *this - x;
+}
+template <typename T>
+inline fvar<T>& fvar<T>::operator*=(const fvar<T>& x) {
+  return *this = *this * x;
+}
+template <typename T>
+inline fvar<T>& fvar<T>::operator/=(const fvar<T>& x) {
+  return *this = *this / x;
+}
+
+/**
+ * Comparisons only look at values.
+ */
+template <typename T>
+inline bool operator==(const fvar<T>& x, const fvar<T>& y) {
+  return x.value_ == y.value_;
+}
+template <typename T>
+inline bool operator!=(const fvar<T>& x, const fvar<T>& y) {
+  return x.value_ != y.value_;
+}
+template <typename T>
+inline bool operator<(const fvar<T>& x, const fvar<T>& y) {
+  return x.value_ < y.value_;
+}
+template <typename T>
+inline bool operator<=(const fvar<T>& x, const fvar<T>& y) {
+  return x.value_ <= y.value_;
+}
+template <typename T>
+inline bool operator>(const fvar<T>& x, const fvar<T>& y) {
+  return x.value_ > y.value_;
+}
+template <typename T>
+inline bool operator>=(const fvar<T>& x, const fvar<T>& y) {
+  return x.value_ >= y.value_;
+}
+
+/**
+ * Math functions. The value and tangent are computed with the functions for
+ * `T`, found through `std` for arithmetic types and ADL otherwise.
+ */
+template <typename T>
+inline fvar<T> square(const fvar<T>& x) {
+  return {x.value_ * x.value_, 2.0 * x.value_ * x.d_};
+}
+template <typename T>
+inline fvar<T> exp(const fvar<T>& x) {
+  using std::exp;
+  T e = exp(x.value_);
+  return {e, x.d_ * e};
+}
+template <typename T>
+inline fvar<T> log(const fvar<T>& x) {
+  using std::log;
+  return {log(x.value_), x.d_ / x.value_};
+}
+template <typename T>
+inline fvar<T> sqrt(const fvar<T>& x) {
+  using std::sqrt;
+  T r = sqrt(x.value_);
+  return {r, 0.5 * x.d_ / r};
+}
+template <typename T>
+inline fvar<T> sin(const fvar<T>& x) {
+  using std::cos;
+  using std::sin;
+  return {sin(x.value_), x.d_ * cos(x.value_)};
+}
+template <typename T>
+inline fvar<T> cos(const fvar<T>& x) {
+  using std::cos;
+  using std::sin;
+  return {cos(x.value_), -(x.d_ * sin(x.value_))};
+}
+
+}  // namespace ad
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef AD_EX_FVAR_NUMTRAITS_HPP
+#define AD_EX_FVAR_NUMTRAITS_HPP
+
+#include <ad_ex/meta/Eigen.hpp>
+#include <ad_ex/fvar.hpp>
+#include <limits>
+
+namespace Eigen {
+
+/**
+ * Numerical traits template override for Eigen for forward mode
+ * dual numbers. Costs are those of the value type, doubled for the
+ * tangent.
+ *
+ * @tparam T value and tangent type
+ */
+template <typename T>
+struct NumTraits<ad::fvar<T>> : GenericNumTraits<ad::fvar<T>> {
+  using Real = ad::fvar<T>;
+  using NonInteger = ad::fvar<T>;
+  using Nested = ad::fvar<T>;
+  using Literal = ad::fvar<T>;
+
+  static inline Real dummy_precision() {
+    return NumTraits<double>::dummy_precision();
+  }
+
+  static inline Real epsilon() { return NumTraits<double>::epsilon(); }
+
+  static inline Real highest() { return NumTraits<double>::highest(); }
+  static inline Real lowest() { return NumTraits<double>::lowest(); }
+
+  enum {
+    IsComplex = 0,
+    IsInteger = 0,
+    IsSigned = 1,
+    RequireInitialization = NumTraits<T>::RequireInitialization,
+    ReadCost = 2 * NumTraits<T>::ReadCost,
+    AddCost = 2 * NumTraits<T>::AddCost,
+    /**
+     * One product for the value and two products and a sum for the tangent.
+     */
+    MulCost = 3 * NumTraits<T>::MulCost + NumTraits<T>::AddCost
+  };
+
+  static int digits10() { return std::numeric_limits<double>::digits10; }
+};
+
+/**
+ * Traits specialization for Eigen binary operations mixing dual numbers
+ * with `double` arguments.
+ */
+template <typename T, typename BinaryOp>
+struct ScalarBinaryOpTraits<ad::fvar<T>, double, BinaryOp> {
+  using ReturnType = ad::fvar<T>;
+};
+
+template <typename T, typename BinaryOp>
+struct ScalarBinaryOpTraits<double, ad::fvar<T>, BinaryOp> {
+  using ReturnType = ad::fvar<T>;
+};
+
+}  // namespace Eigen
+#endif
@@ -1,6 +1,9 @@
 // Type your code here, or load an example.
+#ifndef AD_EX_LAMBDA_HPP
+#define AD_EX_LAMBDA_HPP
 #include <stdint.h>
 
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
 #include <cstdlib>
@@ -13,17 +16,18 @@
 #include <ranges> // For std::views::reverse
 #include <concepts>
 #include <benchmark/benchmark.h>
+#include <ad_ex/tape.hpp>
 
 namespace ad {
 template <typename T>
 concept Arithmetic = std::is_arithmetic_v<std::decay_t<T>>;
-static std::array<std::byte, 8192> buffer;
-static std::pmr::monotonic_buffer_resource mbr{buffer.data(), buffer.size()};
-using alloc_t = std::pmr::polymorphic_allocator<std::byte>;
-static alloc_t pa{&mbr};
 
+/**
+ * Base of every node. Nodes are not called through a vtable, the tape's
+ * `record_stack` stores a direct pointer to each node type's `chain()`.
+ */
 struct var_base_chain {
-  virtual void chain() {};
+  inline void chain() {}
 };
 template <typename T>
 struct var_base;
@@ -42,7 +46,6 @@ struct var_base<T> : public var_base_chain {
     }
 
 };
-static std::vector<var_base_chain*> var_vec;
 namespace detail {
 template <typename T>
 struct is_var_base : std::false_type {};
@@ -56,16 +59,18 @@ struct is_var_base : detail::is_var_base<std::decay_t<T>> {};
 template <typename T>
 inline constexpr bool is_var_base_v = is_var_base<T>::value;
 template <typename T, typename... Args>
-inline auto* make_inbuffer(Args&&... args) {
+inline auto* make_inbuffer(tape& t, Args&&... args) {
   if constexpr (!is_var_base_v<T>) {
-    auto* ret = pa.new_object<T>(std::forward<Args>(args)...);
-    var_vec.push_back(ret);
-    return ret;
+    return t.records_.emplace<T>(std::forward<Args>(args)...);
   } else {
-    auto* ret = pa.new_object<T>(std::forward<Args>(args)...);
+    auto* ret = t.pa_.new_object<T>(std::forward<Args>(args)...);
     return ret;
   }
 }
+template <typename T, typename... Args>
+inline auto* make_inbuffer(Args&&... args) {
+  return make_inbuffer<T>(get_tape(), std::forward<Args>(args)...);
+}
 template <typename T>
 struct var_impl {
   using value_type = std::decay_t<T>;
@@ -92,9 +97,6 @@ struct var_impl {
   var_impl& operator+=(var_impl x);
   auto& adj() { return vi_->adjoint_; }
   const auto& val() const { return vi_->value_; }
-  void chain() {
-    if (vi_) vi_->chain();
-  }
 };
 using var = var_impl<double>;
 template <typename T>
@@ -131,6 +133,10 @@ template <HasVal T>
 inline auto value(T&& x) {
   return x.val();
 }
+template <Arithmetic T>
+inline auto value(T x) {
+  return x;
+}
 #ifdef DEBUG_AD
 void print_var(const char* name, var& ret, var x) {
     std::cout << name << ": (" << value(ret) << ", " << adjoint(ret) << ")"
@@ -158,13 +164,34 @@ struct lambda_var_base final : public var_base<T> {
     template <typename TT>
     lambda_var_base(TT val, Lambda&& lambda)
         : var_base<T>(val), lambda_(std::move(lambda)) {}
-    void chain() {
+    inline void chain() {
       lambda_(*this);
     }
 };
 template <typename T, typename Lambda>
+inline auto make_var(tape& t, T&& ret_val, Lambda&& lambda) {
+    return var_impl<T>(make_inbuffer<lambda_var_base<T, Lambda>>(t, ret_val, std::move(lambda)));
+}
+template <typename T, typename Lambda>
 inline auto make_var(T&& ret_val, Lambda&& lambda) {
-    return var_impl<T>(make_inbuffer<lambda_var_base<T, Lambda>>(ret_val, std::move(lambda)));
+    return make_var(get_tape(), std::forward<T>(ret_val), std::forward<Lambda>(lambda));
+}
+
+/**
+ * Node without a value of its own that calls `f()` in the reverse pass, for
+ * operations whose outputs are separate vars recorded before it.
+ */
+template <typename F>
+struct callback_node final : public var_base_chain {
+    F f_;
+    explicit callback_node(F&& f) : f_(std::move(f)) {}
+    inline void chain() {
+      f_();
+    }
+};
+template <typename F>
+inline void reverse_pass_callback(F&& f) {
+    make_inbuffer<callback_node<std::decay_t<F>>>(std::move(f));
 }
 
 template <typename T1, typename T2>
@@ -188,7 +215,7 @@ inline var& var::operator+=(var x) {
 template <typename T1, typename T2>
 requires any_var_all_scalar<T1, T2>
 inline auto operator*(T1 lhs, T2 rhs) {
-  return make_var(value(lhs) + value(rhs), [lhs, rhs](auto&& ret) mutable {
+  return make_var(value(lhs) * value(rhs), [lhs, rhs](auto&& ret) mutable {
     if constexpr (is_var_v<T1>) {
       adjoint(lhs) += adjoint(ret) * value(rhs);
     }
@@ -204,16 +231,230 @@ inline auto log(var x) {
     });
 }
 
-inline void grad(var z) {
-    adjoint(z) = 1;
-    for (auto&& x : var_vec | std::views::reverse) {
-      x->chain();
+template <typename T1, typename T2>
+requires any_var_all_scalar<T1, T2>
+inline auto operator-(T1 lhs, T2 rhs) {
+  return make_var(value(lhs) - value(rhs), [lhs, rhs](auto&& ret) mutable {
+    if constexpr (is_var_v<T1>) {
+      adjoint(lhs) += adjoint(ret);
+    }
+    if constexpr (is_var_v<T2>) {
+      adjoint(rhs) -= adjoint(ret);
+    }
+  });
+}
+template <typename T1, typename T2>
+requires any_var_all_scalar<T1, T2>
+inline auto operator/(T1 lhs, T2 rhs) {
+  return make_var(value(lhs) / value(rhs), [lhs, rhs](auto&& ret) mutable {
+    if constexpr (is_var_v<T1>) {
+      adjoint(lhs) += adjoint(ret) / value(rhs);
+    }
+    if constexpr (is_var_v<T2>) {
+      adjoint(rhs) -= adjoint(ret) * value(ret) / value(rhs);
     }
+  });
+}
+/**
+ * Comparisons only look at values and record nothing.
+ */
+template <typename T1, typename T2>
+requires any_var_all_scalar<T1, T2>
+inline bool operator==(const T1& lhs, const T2& rhs) {
+  return value(lhs) == value(rhs);
+}
+template <typename T1, typename T2>
+requires any_var_all_scalar<T1, T2>
+inline bool operator!=(const T1& lhs, const T2& rhs) {
+  return value(lhs) != value(rhs);
+}
+template <typename T1, typename T2>
+requires any_var_all_scalar<T1, T2>
+inline bool operator<(const T1& lhs, const T2& rhs) {
+  return value(lhs) < value(rhs);
+}
+template <typename T1, typename T2>
+requires any_var_all_scalar<T1, T2>
+inline bool operator<=(const T1& lhs, const T2& rhs) {
+  return value(lhs) <= value(rhs);
+}
+template <typename T1, typename T2>
+requires any_var_all_scalar<T1, T2>
+inline bool operator>(const T1& lhs, const T2& rhs) {
+  return value(lhs) > value(rhs);
+}
+template <typename T1, typename T2>
+requires any_var_all_scalar<T1, T2>
+inline bool operator>=(const T1& lhs, const T2& rhs) {
+  return value(lhs) >= value(rhs);
+}
+inline auto operator-(var x) {
+    return make_var(-x.val(), [x](auto&& ret) mutable {
+      x.adj() -= ret.adj();
+    });
+}
+inline auto square(var x) {
+    return make_var(x.val() * x.val(), [x](auto&& ret) mutable {
+      x.adj() += 2.0 * ret.adj() * x.val();
+    });
+}
+inline auto exp(var x) {
+    return make_var(std::exp(x.val()), [x](auto&& ret) mutable {
+      x.adj() += ret.adj() * ret.val();
+    });
+}
+inline auto sqrt(var x) {
+    return make_var(std::sqrt(x.val()), [x](auto&& ret) mutable {
+      x.adj() += 0.5 * ret.adj() / ret.val();
+    });
+}
+inline auto sin(var x) {
+    return make_var(std::sin(x.val()), [x](auto&& ret) mutable {
+      x.adj() += ret.adj() * std::cos(x.val());
+    });
+}
+inline auto cos(var x) {
+    return make_var(std::cos(x.val()), [x](auto&& ret) mutable {
+      x.adj() -= ret.adj() * std::sin(x.val());
+    });
+}
+inline auto log1p(var x) {
+    return make_var(std::log1p(x.val()), [x](auto&& ret) mutable {
+      x.adj() += ret.adj() / (1.0 + x.val());
+    });
+}
+template <typename T1, typename T2>
+requires any_var<T1, T2> && any_var_all_scalar<T1, T2>
+inline auto pow(T1 base, T2 exponent) {
+  return make_var(std::pow(value(base), value(exponent)),
+                  [base, exponent](auto&& ret) mutable {
+    if constexpr (is_var_v<T1>) {
+      adjoint(base) += adjoint(ret) * value(exponent)
+                       * std::pow(value(base), value(exponent) - 1.0);
+    }
+    if constexpr (is_var_v<T2>) {
+      adjoint(exponent) += adjoint(ret) * value(ret) * std::log(value(base));
+    }
+  });
+}
+/**
+ * Logistic function `1 / (1 + exp(-x))`, written so neither branch
+ * overflows.
+ */
+inline auto inv_logit(var x) {
+    const double v = x.val();
+    const double ret_val = v >= 0 ? 1.0 / (1.0 + std::exp(-v))
+                                  : std::exp(v) / (1.0 + std::exp(v));
+    return make_var(double(ret_val), [x](auto&& ret) mutable {
+      x.adj() += ret.adj() * ret.val() * (1.0 - ret.val());
+    });
+}
+/**
+ * `log(1 + exp(x))`, computed as `max(x, 0) + log1p(exp(-|x|))` so large
+ * inputs do not overflow.
+ */
+inline auto softplus(var x) {
+    const double v = x.val();
+    return make_var(std::max(v, 0.0) + std::log1p(std::exp(-std::abs(v))),
+                    [x](auto&& ret) mutable {
+      x.adj() += ret.adj() / (1.0 + std::exp(-x.val()));
+    });
 }
 
+/**
+ * Call `chain()` on the nodes of the tape, newest first. Inside a nested
+ * region only the nodes recorded since the last `start_nested()` are swept.
+ */
+inline void chain(tape& t) {
+    if (t.nested_.empty()) {
+      t.records_.chain();
+    } else {
+      t.records_.chain(t.nested_.back().records_);
+    }
+}
+
+/**
+ * Run the reverse pass from `z`.
+ */
+inline void grad(tape& t, var z) {
+    adjoint(z) = 1;
+    chain(t);
+}
+inline void grad(var z) {
+    grad(get_tape(), z);
+}
+
+inline void clear_mem(tape& t) {
+    t.records_.clear();
+    t.nested_.clear();
+    t.mbr_.recover();
+}
 inline void clear_mem() {
-    var_vec.clear();
-    mbr.release();
+    clear_mem(get_tape());
 }
 
+/**
+ * Mark the current end of the tape. Nodes recorded until the matching
+ * `recover_nested()` can be differentiated on their own with `grad()` and
+ * are then thrown away, so their memory is reused right away.
+ *
+ * A nested `grad()` also adds into the adjoints of vars created before the
+ * mark, and nothing takes that back, so an outer gradient through them comes
+ * out wrong. Use copies made inside the region, `var x_inner(x.val())`, in
+ * place of outer vars.
+ */
+inline void start_nested(tape& t) {
+    t.nested_.push_back({t.mbr_.get_mark(), t.records_.get_mark()});
+}
+inline void start_nested() {
+    start_nested(get_tape());
+}
+
+/**
+ * Roll the record stream and arena back to the last `start_nested()`. Vars
+ * created inside the nested region must not be used afterwards.
+ */
+inline void recover_nested(tape& t) {
+    if (t.nested_.empty()) {
+      throw std::logic_error("recover_nested() called outside of a nested region");
+    }
+    t.records_.rewind(t.nested_.back().records_);
+    t.mbr_.rewind(t.nested_.back().arena_);
+    t.nested_.pop_back();
+}
+inline void recover_nested() {
+    recover_nested(get_tape());
 }
+
+/**
+ * Starts a nested region on construction and recovers it on destruction. If
+ * the region is already gone, e.g. after a `clear_mem()` inside it, the
+ * destructor does nothing.
+ */
+struct nested_rev_autodiff {
+    tape& t_;
+    explicit nested_rev_autodiff(tape& t = get_tape()) : t_(t) {
+      start_nested(t_);
+    }
+    nested_rev_autodiff(const nested_rev_autodiff&) = delete;
+    nested_rev_autodiff& operator=(const nested_rev_autodiff&) = delete;
+    ~nested_rev_autodiff() {
+      if (!t_.nested_.empty()) {
+        recover_nested(t_);
+      }
+    }
+};
+
+/**
+ * Pre-size the tape arena, e.g. with `mbr_.peak_bytes()` from a previous
+ * gradient evaluation, so that no chunk has to be allocated mid-gradient.
+ */
+inline void reserve_mem(tape& t, std::size_t bytes) {
+    t.mbr_.reserve(bytes);
+}
+inline void reserve_mem(std::size_t bytes) {
+    reserve_mem(get_tape(), bytes);
+}
+
+}
+#endif
@@ -0,0 +1,188 @@
+#ifndef AD_EX_LANES_HPP
+#define AD_EX_LANES_HPP
+
+#include <ad_ex/meta/Eigen.hpp>
+#include <ad_ex/meta/is_eigen.hpp>
+#include <ad_ex/lambda.hpp>
+#include <type_traits>
+
+namespace ad {
+
+/**
+ * Fixed size column of W doubles, one per independent evaluation.
+ *
+ * `DontAlign` keeps the pack at the alignment of a double so it can sit in
+ * nodes on the `record_stack`, whose records are only 16 byte aligned.
+ * Unaligned vector loads cost next to nothing on current hardware.
+ * @tparam W number of lanes
+ */
+template <int W>
+using lanes = Eigen::Array<double, W, 1, Eigen::DontAlign>;
+
+template <typename T>
+concept LaneArray
+    = is_eigen_v<T>
+      && std::is_base_of_v<Eigen::ArrayBase<std::decay_t<T>>, std::decay_t<T>>
+      && std::is_same_v<typename std::decay_t<T>::Scalar, double>
+      && std::decay_t<T>::ColsAtCompileTime == 1
+      && std::decay_t<T>::RowsAtCompileTime != Eigen::Dynamic;
+
+/**
+ * Leaf holding W values and W adjoints. Every node computes all W lanes at
+ * once, so one forward and reverse sweep gives W gradients while the tape
+ * is only written and walked once.
+ */
+template <typename T>
+requires LaneArray<T>
+struct var_base<T> : public var_base_chain {
+  T value_;
+  T adjoint_;
+  var_base(const T& x) : var_base_chain(), value_(x), adjoint_(T::Zero()) {}
+  inline const auto& val() const { return value_; }
+  inline auto& adj() { return adjoint_; }
+};
+
+template <int W>
+using var_lanes = var_impl<lanes<W>>;
+
+namespace detail {
+template <typename T>
+struct is_var_lanes : std::false_type {};
+template <typename T>
+requires LaneArray<T>
+struct is_var_lanes<var_impl<T>> : std::true_type {};
+}  // namespace detail
+
+template <typename T>
+concept VarLanes = detail::is_var_lanes<std::remove_cvref_t<T>>::value;
+
+/**
+ * A lane var with a double or another lane var of the same width.
+ */
+template <typename A, typename B>
+concept lanes_operands
+    = (VarLanes<A> && VarLanes<B>
+       && std::is_same_v<std::remove_cvref_t<A>, std::remove_cvref_t<B>>)
+      || (VarLanes<A> && Arithmetic<B>) || (Arithmetic<A> && VarLanes<B>);
+
+template <typename T1, typename T2>
+using lanes_value_t =
+    typename std::remove_cvref_t<std::conditional_t<VarLanes<T1>, T1, T2>>::value_type;
+
+template <typename T1, typename T2>
+requires lanes_operands<T1, T2>
+inline auto operator+(T1 lhs, T2 rhs) {
+  using ret_t = lanes_value_t<T1, T2>;
+  return make_var(ret_t(value(lhs) + value(rhs)), [lhs, rhs](auto&& ret) mutable {
+    if constexpr (VarLanes<T1>) {
+      adjoint(lhs) += adjoint(ret);
+    }
+    if constexpr (VarLanes<T2>) {
+      adjoint(rhs) += adjoint(ret);
+    }
+  });
+}
+template <typename T1, typename T2>
+requires lanes_operands<T1, T2>
+inline auto operator-(T1 lhs, T2 rhs) {
+  using ret_t = lanes_value_t<T1, T2>;
+  return make_var(ret_t(value(lhs) - value(rhs)), [lhs, rhs](auto&& ret) mutable {
+    if constexpr (VarLanes<T1>) {
+      adjoint(lhs) += adjoint(ret);
+    }
+    if constexpr (VarLanes<T2>) {
+      adjoint(rhs) -= adjoint(ret);
+    }
+  });
+}
+template <typename T1, typename T2>
+requires lanes_operands<T1, T2>
+inline auto operator*(T1 lhs, T2 rhs) {
+  using ret_t = lanes_value_t<T1, T2>;
+  return make_var(ret_t(value(lhs) * value(rhs)), [lhs, rhs](auto&& ret) mutable {
+    if constexpr (VarLanes<T1>) {
+      adjoint(lhs) += adjoint(ret) * value(rhs);
+    }
+    if constexpr (VarLanes<T2>) {
+      adjoint(rhs) += adjoint(ret) * value(lhs);
+    }
+  });
+}
+template <typename T1, typename T2>
+requires lanes_operands<T1, T2>
+inline auto operator/(T1 lhs, T2 rhs) {
+  using ret_t = lanes_value_t<T1, T2>;
+  return make_var(ret_t(value(lhs) / value(rhs)), [lhs, rhs](auto&& ret) mutable {
+    if constexpr (VarLanes<T1>) {
+      adjoint(lhs) += adjoint(ret) / value(rhs);
+    }
+    if constexpr (VarLanes<T2>) {
+      adjoint(rhs) -= adjoint(ret) * value(ret) / value(rhs);
+    }
+  });
+}
+template <VarLanes T>
+inline auto operator-(T x) {
+  using ret_t = typename T::value_type;
+  return make_var(ret_t(-x.val()), [x](auto&& ret) mutable {
+    x.adj() -= ret.adj();
+  });
+}
+template <VarLanes T>
+inline auto square(T x) {
+  using ret_t = typename T::value_type;
+  return make_var(ret_t(x.val().square()), [x](auto&& ret) mutable {
+    x.adj() += 2.0 * ret.adj() * x.val();
+  });
+}
+template <VarLanes T>
+inline auto log(T x) {
+  using ret_t = typename T::value_type;
+  return make_var(ret_t(x.val().log()), [x](auto&& ret) mutable {
+    x.adj() += ret.adj() / x.val();
+  });
+}
+template <VarLanes T>
+inline auto exp(T x) {
+  using ret_t = typename T::value_type;
+  return make_var(ret_t(x.val().exp()), [x](auto&& ret) mutable {
+    x.adj() += ret.adj() * ret.val();
+  });
+}
+template <VarLanes T>
+inline auto sqrt(T x) {
+  using ret_t = typename T::value_type;
+  return make_var(ret_t(x.val().sqrt()), [x](auto&& ret) mutable {
+    x.adj() += 0.5 * ret.adj() / ret.val();
+  });
+}
+template <VarLanes T>
+inline auto sin(T x) {
+  using ret_t = typename T::value_type;
+  return make_var(ret_t(x.val().sin()), [x](auto&& ret) mutable {
+    x.adj() += ret.adj() * x.val().cos();
+  });
+}
+template <VarLanes T>
+inline auto cos(T x) {
+  using ret_t = typename T::value_type;
+  return make_var(ret_t(x.val().cos()), [x](auto&& ret) mutable {
+    x.adj() -= ret.adj() * x.val().sin();
+  });
+}
+
+/**
+ * Run the reverse pass from every lane of `z` at once.
+ */
+template <VarLanes T>
+inline void grad(tape& t, T z) {
+  z.adj().setOnes();
+  chain(t);
+}
+template <VarLanes T>
+inline void grad(T z) {
+  grad(get_tape(), z);
+}
+
+}  // namespace ad
+#endif
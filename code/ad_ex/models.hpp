@@ -0,0 +1,516 @@
+#ifndef AD_EX_MODELS_HPP
+#define AD_EX_MODELS_HPP
+
+#include <ad_ex/meta/Eigen.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <random>
+#include <span>
+#include <string_view>
+#include <vector>
+
+/**
+ * Log densities of small but realistic models, written once for any scalar.
+ *
+ * Each model holds its data, a parameter point to evaluate at and a templated
+ * `operator()` returning the log density of a `std::vector` of parameters.
+ * Math functions are found through `std` for doubles and ADL for AD scalars,
+ * and the code only uses `+ - * /`, `exp`, `log` and `sqrt` so that every
+ * backend in `backends.hpp` can run it. Each model also has a hand written
+ * double gradient, in the style of `baseline.cpp`, which is the reference the
+ * backends are checked and timed against.
+ *
+ * Data is drawn from a fixed seed, so a model of a given size is the same
+ * on every run and for every backend.
+ */
+namespace ad::models {
+
+/**
+ * A model: a log density templated on the scalar type, its number of
+ * parameters, a point to evaluate at and a hand written gradient.
+ */
+template <typename M>
+concept model = requires(const M& m, std::span<const double> x,
+                         std::span<double> g) {
+  { M::name } -> std::convertible_to<std::string_view>;
+  { m.dims() } -> std::convertible_to<std::size_t>;
+  { m.initial() } -> std::same_as<std::vector<double>>;
+  { m(std::vector<double>{}) } -> std::same_as<double>;
+  { m.gradient(x, g) } -> std::same_as<double>;
+};
+
+/**
+ * Bayesian logistic regression with `n` observations of `k` covariates and
+ * a standard normal prior on the coefficients.
+ */
+struct logistic_regression {
+  static constexpr std::string_view name = "logistic_regression";
+  std::size_t n_;
+  std::size_t k_;
+  std::vector<double> x_;  // n x k, row major
+  std::vector<double> y_;
+
+  explicit logistic_regression(std::size_t n, std::size_t k = 8)
+      : n_(n), k_(k), x_(n * k), y_(n) {
+    std::mt19937 rng(1234);
+    std::normal_distribution<double> normal;
+    std::vector<double> beta(k_);
+    for (auto& b : beta) {
+      b = normal(rng);
+    }
+    std::uniform_real_distribution<double> unif;
+    for (std::size_t i = 0; i < n_; ++i) {
+      double eta = 0;
+      for (std::size_t j = 0; j < k_; ++j) {
+        x_[i * k_ + j] = normal(rng);
+        eta += x_[i * k_ + j] * beta[j];
+      }
+      y_[i] = unif(rng) < 1.0 / (1.0 + std::exp(-eta));
+    }
+  }
+
+  inline std::size_t dims() const { return k_; }
+  inline std::vector<double> initial() const {
+    return std::vector<double>(k_, 0.1);
+  }
+
+  template <typename T>
+  inline T operator()(const std::vector<T>& beta) const {
+    using std::exp;
+    using std::log;
+    T lp(0.0);
+    for (std::size_t j = 0; j < k_; ++j) {
+      lp = lp - 0.5 * beta[j] * beta[j];
+    }
+    for (std::size_t i = 0; i < n_; ++i) {
+      T eta = x_[i * k_] * beta[0];
+      for (std::size_t j = 1; j < k_; ++j) {
+        eta = eta + x_[i * k_ + j] * beta[j];
+      }
+      lp = lp + y_[i] * eta - log(1.0 + exp(eta));
+    }
+    return lp;
+  }
+
+  inline double gradient(std::span<const double> beta,
+                         std::span<double> g) const {
+    double lp = 0;
+    for (std::size_t j = 0; j < k_; ++j) {
+      lp -= 0.5 * beta[j] * beta[j];
+      g[j] = -beta[j];
+    }
+    for (std::size_t i = 0; i < n_; ++i) {
+      double eta = 0;
+      for (std::size_t j = 0; j < k_; ++j) {
+        eta += x_[i * k_ + j] * beta[j];
+      }
+      const double e = std::exp(eta);
+      lp += y_[i] * eta - std::log(1.0 + e);
+      const double r = y_[i] - e / (1.0 + e);
+      for (std::size_t j = 0; j < k_; ++j) {
+        g[j] += r * x_[i * k_ + j];
+      }
+    }
+    return lp;
+  }
+};
+
+/**
+ * Non-centered hierarchical normal model ("eight schools" with `j` groups).
+ * Parameters are `mu`, `log(tau)` and one standardized effect per group.
+ */
+struct hierarchical_normal {
+  static constexpr std::string_view name = "hierarchical_normal";
+  std::size_t j_;
+  std::vector<double> y_;
+  std::vector<double> inv_sigma_;
+
+  explicit hierarchical_normal(std::size_t j) : j_(j), y_(j), inv_sigma_(j) {
+    std::mt19937 rng(1234);
+    std::normal_distribution<double> normal;
+    std::uniform_real_distribution<double> sigma(0.5, 2.0);
+    for (std::size_t i = 0; i < j_; ++i) {
+      const double s = sigma(rng);
+      y_[i] = 1.0 + 2.0 * normal(rng) + s * normal(rng);
+      inv_sigma_[i] = 1.0 / s;
+    }
+  }
+
+  inline std::size_t dims() const { return j_ + 2; }
+  inline std::vector<double> initial() const {
+    std::vector<double> theta(dims(), 0.1);
+    theta[1] = 0.5;
+    return theta;
+  }
+
+  template <typename T>
+  inline T operator()(const std::vector<T>& theta) const {
+    using std::exp;
+    const T& mu = theta[0];
+    const T tau = exp(theta[1]);
+    // mu ~ normal(0, 5), tau ~ half normal(0, 5) plus the log Jacobian.
+    T lp = -0.02 * mu * mu - 0.02 * tau * tau + theta[1];
+    for (std::size_t i = 0; i < j_; ++i) {
+      const T& z = theta[i + 2];
+      const T r = (y_[i] - (mu + tau * z)) * inv_sigma_[i];
+      lp = lp - 0.5 * z * z - 0.5 * r * r;
+    }
+    return lp;
+  }
+
+  inline double gradient(std::span<const double> theta,
+                         std::span<double> g) const {
+    const double mu = theta[0];
+    const double tau = std::exp(theta[1]);
+    double lp = -0.02 * mu * mu - 0.02 * tau * tau + theta[1];
+    g[0] = -0.04 * mu;
+    g[1] = 1.0 - 0.04 * tau * tau;
+    for (std::size_t i = 0; i < j_; ++i) {
+      const double z = theta[i + 2];
+      const double r = (y_[i] - (mu + tau * z)) * inv_sigma_[i];
+      lp -= 0.5 * z * z + 0.5 * r * r;
+      const double d = r * inv_sigma_[i];
+      g[0] += d;
+      g[1] += d * tau * z;
+      g[i + 2] = tau * d - z;
+    }
+    return lp;
+  }
+};
+
+/**
+ * Marginal likelihood of a Gaussian process with a squared exponential
+ * kernel on `n` one dimensional inputs. Parameters are the log length
+ * scale, log marginal standard deviation and log noise standard deviation.
+ * The generic version factors the covariance with a scalar Cholesky, so an
+ * AD backend records O(n^3) operations.
+ */
+struct gp_marginal {
+  static constexpr std::string_view name = "gp_marginal";
+  std::size_t n_;
+  std::vector<double> x_;
+  std::vector<double> y_;
+
+  explicit gp_marginal(std::size_t n) : n_(n), x_(n), y_(n) {
+    std::mt19937 rng(1234);
+    std::normal_distribution<double> normal;
+    for (std::size_t i = 0; i < n_; ++i) {
+      x_[i] = 10.0 * i / n_;
+      y_[i] = std::sin(x_[i]) + 0.3 * normal(rng);
+    }
+  }
+
+  inline std::size_t dims() const { return 3; }
+  inline std::vector<double> initial() const { return {0.0, 0.0, -1.0}; }
+
+  template <typename T>
+  inline T operator()(const std::vector<T>& theta) const {
+    using std::exp;
+    using std::log;
+    using std::sqrt;
+    const T rho = exp(theta[0]);
+    const T alpha = exp(theta[1]);
+    const T sigma = exp(theta[2]);
+    const T alpha_sq = alpha * alpha;
+    const T sigma_sq = sigma * sigma;
+    const T inv_two_rho_sq = 0.5 / (rho * rho);
+    // Lower triangle of the Cholesky factor, packed row by row.
+    std::vector<T> L;
+    L.reserve(n_ * (n_ + 1) / 2);
+    auto l = [&L](std::size_t i, std::size_t j) -> const T& {
+      return L[i * (i + 1) / 2 + j];
+    };
+    for (std::size_t i = 0; i < n_; ++i) {
+      for (std::size_t j = 0; j <= i; ++j) {
+        const double d = x_[i] - x_[j];
+        T s = alpha_sq * exp(-(d * d) * inv_two_rho_sq);
+        if (i == j) {
+          s = s + sigma_sq;
+        }
+        for (std::size_t k = 0; k < j; ++k) {
+          s = s - l(i, k) * l(j, k);
+        }
+        L.push_back(i == j ? sqrt(s) : s / l(j, j));
+      }
+    }
+    // Solve L a = y, then log p(y) = -a'a / 2 - log |L| + const.
+    std::vector<T> a;
+    a.reserve(n_);
+    T lp(0.0);
+    for (std::size_t i = 0; i < n_; ++i) {
+      T s(y_[i]);
+      for (std::size_t k = 0; k < i; ++k) {
+        s = s - l(i, k) * a[k];
+      }
+      a.push_back(s / l(i, i));
+      lp = lp - 0.5 * a[i] * a[i] - log(l(i, i));
+    }
+    return lp;
+  }
+
+  inline double gradient(std::span<const double> theta,
+                         std::span<double> g) const {
+    const double rho = std::exp(theta[0]);
+    const double alpha_sq = std::exp(2 * theta[1]);
+    const double sigma_sq = std::exp(2 * theta[2]);
+    const auto n = static_cast<Eigen::Index>(n_);
+    Eigen::MatrixXd K_se(n, n);
+    Eigen::MatrixXd d_sq(n, n);
+    for (Eigen::Index j = 0; j < n; ++j) {
+      for (Eigen::Index i = 0; i < n; ++i) {
+        const double d = x_[i] - x_[j];
+        d_sq(i, j) = d * d;
+        K_se(i, j) = alpha_sq * std::exp(-0.5 * d * d / (rho * rho));
+      }
+    }
+    Eigen::MatrixXd K = K_se;
+    K.diagonal().array() += sigma_sq;
+    Eigen::LLT<Eigen::MatrixXd> llt(K);
+    const Eigen::Map<const Eigen::VectorXd> y(y_.data(), n);
+    const Eigen::VectorXd a = llt.solve(y);
+    const double lp
+        = -0.5 * y.dot(a) - llt.matrixLLT().diagonal().array().log().sum();
+    // d log p / d theta = tr((a a' - K^-1) dK / d theta) / 2
+    const Eigen::MatrixXd W
+        = a * a.transpose() - llt.solve(Eigen::MatrixXd::Identity(n, n));
+    g[0] = 0.5 * (W.array() * K_se.array() * d_sq.array()).sum() / (rho * rho);
+    g[1] = (W.array() * K_se.array()).sum();
+    g[2] = W.trace() * sigma_sq;
+    return lp;
+  }
+};
+
+/**
+ * Regression with a one hidden layer perceptron on `n` observations of `d`
+ * inputs, `h` tanh hidden units, a normal likelihood and a standard normal
+ * prior on the weights. Parameters are the hidden weights (row major), the
+ * hidden biases, the output weights and the output bias.
+ */
+struct mlp {
+  static constexpr std::string_view name = "mlp";
+  std::size_t n_;
+  std::size_t d_;
+  std::size_t h_;
+  std::vector<double> x_;  // n x d, row major
+  std::vector<double> y_;
+
+  explicit mlp(std::size_t n, std::size_t d = 4, std::size_t h = 16)
+      : n_(n), d_(d), h_(h), x_(n * d), y_(n) {
+    std::mt19937 rng(1234);
+    std::normal_distribution<double> normal;
+    for (std::size_t i = 0; i < n_; ++i) {
+      for (std::size_t j = 0; j < d_; ++j) {
+        x_[i * d_ + j] = normal(rng);
+      }
+      y_[i] = std::sin(x_[i * d_]) + 0.5 * x_[i * d_ + 1] + 0.1 * normal(rng);
+    }
+  }
+
+  inline std::size_t dims() const { return h_ * d_ + 2 * h_ + 1; }
+  inline std::vector<double> initial() const {
+    std::vector<double> theta(dims());
+    for (std::size_t i = 0; i < theta.size(); ++i) {
+      theta[i] = 0.1 * static_cast<double>(i % 7) - 0.3;
+    }
+    return theta;
+  }
+
+  template <typename T>
+  inline T operator()(const std::vector<T>& theta) const {
+    using std::exp;
+    const std::size_t b1 = h_ * d_;
+    const std::size_t w2 = b1 + h_;
+    const std::size_t b2 = w2 + h_;
+    T lp(0.0);
+    for (std::size_t p = 0; p < theta.size(); ++p) {
+      lp = lp - 0.5 * theta[p] * theta[p];
+    }
+    for (std::size_t i = 0; i < n_; ++i) {
+      T out = theta[b2];
+      for (std::size_t k = 0; k < h_; ++k) {
+        T a = theta[b1 + k];
+        for (std::size_t j = 0; j < d_; ++j) {
+          a = a + theta[k * d_ + j] * x_[i * d_ + j];
+        }
+        const T t = 1.0 - 2.0 / (exp(2.0 * a) + 1.0);
+        out = out + theta[w2 + k] * t;
+      }
+      const T r = y_[i] - out;
+      lp = lp - 0.5 * r * r;
+    }
+    return lp;
+  }
+
+  inline double gradient(std::span<const double> theta,
+                         std::span<double> g) const {
+    const std::size_t b1 = h_ * d_;
+    const std::size_t w2 = b1 + h_;
+    const std::size_t b2 = w2 + h_;
+    double lp = 0;
+    for (std::size_t p = 0; p < theta.size(); ++p) {
+      lp -= 0.5 * theta[p] * theta[p];
+      g[p] = -theta[p];
+    }
+    std::vector<double> t(h_);
+    for (std::size_t i = 0; i < n_; ++i) {
+      const double* x = &x_[i * d_];
+      double out = theta[b2];
+      for (std::size_t k = 0; k < h_; ++k) {
+        double a = theta[b1 + k];
+        for (std::size_t j = 0; j < d_; ++j) {
+          a += theta[k * d_ + j] * x[j];
+        }
+        t[k] = std::tanh(a);
+        out += theta[w2 + k] * t[k];
+      }
+      const double r = y_[i] - out;
+      lp -= 0.5 * r * r;
+      g[b2] += r;
+      for (std::size_t k = 0; k < h_; ++k) {
+        g[w2 + k] += r * t[k];
+        const double da = r * theta[w2 + k] * (1.0 - t[k] * t[k]);
+        g[b1 + k] += da;
+        for (std::size_t j = 0; j < d_; ++j) {
+          g[k * d_ + j] += da * x[j];
+        }
+      }
+    }
+    return lp;
+  }
+};
+
+/**
+ * Lotka-Volterra predator-prey ODE integrated with `steps` fixed RK4 steps
+ * and fit to noisy observations of both populations after every step.
+ * Parameters are the four rates `alpha, beta, gamma, delta` of
+ * `u' = alpha u - beta u v` and `v' = delta u v - gamma v`.
+ */
+struct rk4_ode {
+  static constexpr std::string_view name = "rk4_ode";
+  static constexpr double h = 0.05;
+  static constexpr double u0 = 2.0;
+  static constexpr double v0 = 1.0;
+  static constexpr double inv_sigma_sq = 100.0;
+  std::size_t steps_;
+  std::vector<double> obs_;  // steps x 2
+
+  explicit rk4_ode(std::size_t steps) : steps_(steps), obs_(2 * steps) {
+    std::mt19937 rng(1234);
+    std::normal_distribution<double> normal;
+    const std::vector<double> truth{1.0, 0.5, 1.0, 0.5};
+    integrate(truth, [&](std::size_t t, double u, double v) {
+      obs_[2 * t] = u + 0.1 * normal(rng);
+      obs_[2 * t + 1] = v + 0.1 * normal(rng);
+    });
+  }
+
+  inline std::size_t dims() const { return 4; }
+  inline std::vector<double> initial() const { return {1.1, 0.55, 0.9, 0.45}; }
+
+  /**
+   * Integrate the ODE, calling `observe(step, u, v)` after every step.
+   */
+  template <typename T, typename F>
+  inline void integrate(const std::vector<T>& theta, F&& observe) const {
+    auto f = [&theta](const T& u, const T& v) {
+      const T uv = u * v;
+      return std::array<T, 2>{theta[0] * u - theta[1] * uv,
+                              theta[3] * uv - theta[2] * v};
+    };
+    T u(u0);
+    T v(v0);
+    for (std::size_t t = 0; t < steps_; ++t) {
+      const auto k1 = f(u, v);
+      const auto k2 = f(u + (0.5 * h) * k1[0], v + (0.5 * h) * k1[1]);
+      const auto k3 = f(u + (0.5 * h) * k2[0], v + (0.5 * h) * k2[1]);
+      const auto k4 = f(u + h * k3[0], v + h * k3[1]);
+      u = u + (h / 6.0) * (k1[0] + 2.0 * k2[0] + 2.0 * k3[0] + k4[0]);
+      v = v + (h / 6.0) * (k1[1] + 2.0 * k2[1] + 2.0 * k3[1] + k4[1]);
+      observe(t, u, v);
+    }
+  }
+
+  template <typename T>
+  inline T operator()(const std::vector<T>& theta) const {
+    T lp(0.0);
+    integrate(theta, [&](std::size_t t, const T& u, const T& v) {
+      const T ru = u - obs_[2 * t];
+      const T rv = v - obs_[2 * t + 1];
+      lp = lp - (0.5 * inv_sigma_sq) * (ru * ru + rv * rv);
+    });
+    return lp;
+  }
+
+  /**
+   * Forward sensitivities pushed through every RK4 stage alongside the
+   * state, so the gradient is that of the discrete solution.
+   */
+  inline double gradient(std::span<const double> theta,
+                         std::span<double> g) const {
+    const double alpha = theta[0], beta = theta[1], gamma = theta[2],
+                 delta = theta[3];
+    using sens = std::array<std::array<double, 4>, 2>;
+    // State derivative and its Jacobian times the sensitivities s.
+    auto f = [&](double u, double v, const sens& s, double& du, double& dv,
+                 sens& ds) {
+      du = alpha * u - beta * u * v;
+      dv = delta * u * v - gamma * v;
+      const double ju[2] = {alpha - beta * v, -beta * u};
+      const double jv[2] = {delta * v, delta * u - gamma};
+      for (std::size_t p = 0; p < 4; ++p) {
+        ds[0][p] = ju[0] * s[0][p] + ju[1] * s[1][p];
+        ds[1][p] = jv[0] * s[0][p] + jv[1] * s[1][p];
+      }
+      ds[0][0] += u;
+      ds[0][1] -= u * v;
+      ds[1][2] -= v;
+      ds[1][3] += u * v;
+    };
+    auto axpy = [](const sens& s, double a, const sens& k) {
+      sens r;
+      for (std::size_t i = 0; i < 2; ++i) {
+        for (std::size_t p = 0; p < 4; ++p) {
+          r[i][p] = s[i][p] + a * k[i][p];
+        }
+      }
+      return r;
+    };
+    double u = u0, v = v0;
+    sens s{};
+    double lp = 0;
+    std::fill(g.begin(), g.begin() + 4, 0.0);
+    for (std::size_t t = 0; t < steps_; ++t) {
+      double ku[4], kv[4];
+      sens ks[4];
+      f(u, v, s, ku[0], kv[0], ks[0]);
+      f(u + 0.5 * h * ku[0], v + 0.5 * h * kv[0], axpy(s, 0.5 * h, ks[0]),
+        ku[1], kv[1], ks[1]);
+      f(u + 0.5 * h * ku[1], v + 0.5 * h * kv[1], axpy(s, 0.5 * h, ks[1]),
+        ku[2], kv[2], ks[2]);
+      f(u + h * ku[2], v + h * kv[2], axpy(s, h, ks[2]), ku[3], kv[3], ks[3]);
+      u += h / 6.0 * (ku[0] + 2.0 * ku[1] + 2.0 * ku[2] + ku[3]);
+      v += h / 6.0 * (kv[0] + 2.0 * kv[1] + 2.0 * kv[2] + kv[3]);
+      for (std::size_t i = 0; i < 2; ++i) {
+        for (std::size_t p = 0; p < 4; ++p) {
+          s[i][p] += h / 6.0
+                     * (ks[0][i][p] + 2.0 * ks[1][i][p] + 2.0 * ks[2][i][p]
+                        + ks[3][i][p]);
+        }
+      }
+      const double ru = u - obs_[2 * t];
+      const double rv = v - obs_[2 * t + 1];
+      lp -= 0.5 * inv_sigma_sq * (ru * ru + rv * rv);
+      for (std::size_t p = 0; p < 4; ++p) {
+        g[p] -= inv_sigma_sq * (ru * s[0][p] + rv * s[1][p]);
+      }
+    }
+    return lp;
+  }
+};
+
+}  // namespace ad::models
+
+#endif
@@ -0,0 +1,266 @@
+#ifndef AD_EX_PROFILE_HPP
+#define AD_EX_PROFILE_HPP
+
+#include <ad_ex/lambda.hpp>
+#include <ad_ex/profile_counters.hpp>
+#include <ad_ex/tape_stats.hpp>
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Profiling is compiled in with `-DAD_PROFILE`. Without it `profile` regions
+ * are empty objects, nodes are recorded and chained exactly as before, and
+ * the report is empty.
+ */
+
+namespace ad {
+
+/**
+ * Calls and cycles of one node type or one `profile` region.
+ */
+struct profile_entry {
+  std::string name_;
+  std::uint64_t forward_calls_{0};
+  std::uint64_t forward_cycles_{0};
+  std::uint64_t reverse_calls_{0};
+  std::uint64_t reverse_cycles_{0};
+};
+
+/**
+ * Where the forward and reverse passes spent their time since the last
+ * `reset_profile()`, node types and regions each sorted by total cycles.
+ *
+ * A node type's forward time is the construction of its node. Ops that
+ * evaluate their value into the node, such as `make_var_matrix`, include that
+ * work; scalar ops compute their value before the node is made, so time it
+ * with a `profile` region when it matters. Reverse time is the node's
+ * `chain()`. Both are inclusive of anything they call.
+ */
+struct profile_report {
+  std::vector<profile_entry> nodes_;
+  std::vector<profile_entry> regions_;
+};
+
+namespace detail {
+/**
+ * Named regions by name. The map only grows, so counters stay put.
+ */
+struct profile_regions {
+  std::mutex mutex_;
+  std::map<std::string, profile_counters, std::less<>> regions_;
+};
+
+inline profile_regions& get_profile_regions() {
+  static profile_regions regions;
+  return regions;
+}
+
+inline profile_counters& get_profile_region(std::string_view name) {
+  auto& regions = get_profile_regions();
+  std::lock_guard<std::mutex> lock(regions.mutex_);
+  auto it = regions.regions_.find(name);
+  if (it == regions.regions_.end()) {
+    it = regions.regions_.try_emplace(std::string(name)).first;
+  }
+  return it->second;
+}
+
+inline profile_entry make_profile_entry(std::string name,
+                                        const profile_counters& counters) {
+  return {std::move(name),
+          counters.forward_calls_.load(std::memory_order_relaxed),
+          counters.forward_cycles_.load(std::memory_order_relaxed),
+          counters.reverse_calls_.load(std::memory_order_relaxed),
+          counters.reverse_cycles_.load(std::memory_order_relaxed)};
+}
+
+inline void sort_profile_entries(std::vector<profile_entry>& entries) {
+  std::sort(entries.begin(), entries.end(), [](auto&& a, auto&& b) {
+    return a.forward_cycles_ + a.reverse_cycles_
+           > b.forward_cycles_ + b.reverse_cycles_;
+  });
+}
+}  // namespace detail
+
+#ifdef AD_PROFILE
+/**
+ * Named region of a gradient, timed in both passes, in the style of Stan's
+ * `profile` blocks. The forward time is the lifetime of the object. The
+ * reverse time is measured by two callback nodes recorded when the region
+ * opens and closes, so it covers the `chain()` of every node recorded in
+ * between. Those two nodes show up in the report as `profile::reverse_begin`
+ * and `profile::reverse_end`.
+ * @code
+ * {
+ *   ad::profile p("likelihood");
+ *   lp = sum(...);
+ * }
+ * @endcode
+ */
+class profile {
+ public:
+  explicit profile(std::string_view name, tape& t = get_tape())
+      : tape_(t),
+        counters_(&detail::get_profile_region(name)),
+        reverse_start_(t.pa_.new_object<std::uint64_t>(0)) {
+    make_inbuffer<reverse_end>(tape_, counters_, reverse_start_);
+    start_ = profile_cycles();
+  }
+
+  profile(const profile&) = delete;
+  profile& operator=(const profile&) = delete;
+
+  ~profile() {
+    counters_->add_forward(profile_cycles() - start_);
+    make_inbuffer<reverse_begin>(tape_, reverse_start_);
+  }
+
+ private:
+  /**
+   * Recorded when the region closes, so chained first.
+   */
+  struct reverse_begin final : public var_base_chain {
+    std::uint64_t* start_;
+    explicit reverse_begin(std::uint64_t* start) : start_(start) {}
+    inline void chain() { *start_ = profile_cycles(); }
+  };
+  /**
+   * Recorded when the region opens, so chained last.
+   */
+  struct reverse_end final : public var_base_chain {
+    profile_counters* counters_;
+    std::uint64_t* start_;
+    reverse_end(profile_counters* counters, std::uint64_t* start)
+        : counters_(counters), start_(start) {}
+    inline void chain() { counters_->add_reverse(profile_cycles() - *start_); }
+  };
+
+  tape& tape_;
+  profile_counters* counters_;
+  std::uint64_t* reverse_start_;
+  std::uint64_t start_;
+};
+#else
+class profile {
+ public:
+  explicit profile(std::string_view, tape& = get_tape()) {}
+  profile(const profile&) = delete;
+  profile& operator=(const profile&) = delete;
+};
+#endif
+
+/**
+ * Collect the profile of every node type and region since the last
+ * `reset_profile()`. Node types with the same label are merged, as in
+ * `get_stats()`.
+ */
+inline profile_report get_profile() {
+  profile_report report;
+#ifdef AD_PROFILE
+  std::unordered_map<std::string, profile_entry> by_label;
+  record_stack::for_each_node_profile([&](auto chain, const auto& counters) {
+    auto label = detail::node_label(record_stack::node_name(chain));
+    auto entry = detail::make_profile_entry(label, counters);
+    auto& merged = by_label[label];
+    merged.name_ = label;
+    merged.forward_calls_ += entry.forward_calls_;
+    merged.forward_cycles_ += entry.forward_cycles_;
+    merged.reverse_calls_ += entry.reverse_calls_;
+    merged.reverse_cycles_ += entry.reverse_cycles_;
+  });
+  for (auto&& [label, entry] : by_label) {
+    if (entry.forward_calls_ + entry.reverse_calls_ > 0) {
+      report.nodes_.push_back(std::move(entry));
+    }
+  }
+  auto& regions = detail::get_profile_regions();
+  {
+    std::lock_guard<std::mutex> lock(regions.mutex_);
+    for (auto&& [name, counters] : regions.regions_) {
+      auto entry = detail::make_profile_entry(name, counters);
+      if (entry.forward_calls_ + entry.reverse_calls_ > 0) {
+        report.regions_.push_back(std::move(entry));
+      }
+    }
+  }
+  detail::sort_profile_entries(report.nodes_);
+  detail::sort_profile_entries(report.regions_);
+#endif
+  return report;
+}
+
+/**
+ * Zero the counters of every node type and region.
+ */
+inline void reset_profile() {
+#ifdef AD_PROFILE
+  record_stack::for_each_node_profile(
+      [](auto, auto& counters) { counters.reset(); });
+  auto& regions = detail::get_profile_regions();
+  std::lock_guard<std::mutex> lock(regions.mutex_);
+  for (auto&& [name, counters] : regions.regions_) {
+    counters.reset();
+  }
+#endif
+}
+
+/**
+ * Print `report` as one table of regions and one of node types, with calls
+ * and cycles per call for each pass.
+ */
+inline std::ostream& operator<<(std::ostream& os, const profile_report& report) {
+  auto print = [&os](const char* title, auto&& entries) {
+    if (entries.empty()) {
+      return;
+    }
+    os << title << ": calls, cycles per call (forward | reverse)\n";
+    for (auto&& e : entries) {
+      os << "  " << e.name_ << ": " << e.forward_calls_ << ", "
+         << (e.forward_calls_ ? e.forward_cycles_ / e.forward_calls_ : 0)
+         << " | " << e.reverse_calls_ << ", "
+         << (e.reverse_calls_ ? e.reverse_cycles_ / e.reverse_calls_ : 0)
+         << "\n";
+    }
+  };
+  print("regions", report.regions_);
+  print("nodes", report.nodes_);
+  return os;
+}
+
+/**
+ * Report the profile as benchmark counters and start a new one. Each node
+ * type and region gets `fwd:<name>` and `rev:<name>`, the cycles it took per
+ * benchmark iteration, so the counters of one run add up to where its time
+ * went. Regions are named `profile:<name>`. Does nothing without
+ * `AD_PROFILE`.
+ */
+inline void report_profile(benchmark::State& state) {
+#ifdef AD_PROFILE
+  const auto report = get_profile();
+  const double iterations = std::max<double>(state.iterations(), 1);
+  auto add = [&](const std::string& name, const profile_entry& e) {
+    state.counters["fwd:" + name] = e.forward_cycles_ / iterations;
+    state.counters["rev:" + name] = e.reverse_cycles_ / iterations;
+  };
+  for (auto&& e : report.regions_) {
+    add("profile:" + e.name_, e);
+  }
+  for (auto&& e : report.nodes_) {
+    add(e.name_, e);
+  }
+  reset_profile();
+#endif
+}
+
+}  // namespace ad
+
+#endif
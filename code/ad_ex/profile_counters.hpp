@@ -0,0 +1,69 @@
+#ifndef AD_EX_PROFILE_COUNTERS_HPP
+#define AD_EX_PROFILE_COUNTERS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace ad {
+
+/**
+ * @return a cycle count from the time stamp counter, or steady clock ticks
+ *  where there is none
+ */
+inline std::uint64_t profile_cycles() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+/**
+ * Calls of one kind of work and the cycles they took, split into the forward
+ * pass and the reverse pass.
+ *
+ * Counters are shared by all threads and updated with relaxed atomic adds, so
+ * counts stay exact when `reduce_sum()` workers record the same node types at
+ * once. The pair of cycle counter reads around each call costs more than the
+ * adds.
+ */
+struct profile_counters {
+  std::atomic<std::uint64_t> forward_calls_{0};
+  std::atomic<std::uint64_t> forward_cycles_{0};
+  std::atomic<std::uint64_t> reverse_calls_{0};
+  std::atomic<std::uint64_t> reverse_cycles_{0};
+
+  inline void add_forward(std::uint64_t cycles) noexcept {
+    add(forward_calls_, 1);
+    add(forward_cycles_, cycles);
+  }
+  inline void add_reverse(std::uint64_t cycles) noexcept {
+    add(reverse_calls_, 1);
+    add(reverse_cycles_, cycles);
+  }
+  inline void reset() noexcept {
+    forward_calls_.store(0, std::memory_order_relaxed);
+    forward_cycles_.store(0, std::memory_order_relaxed);
+    reverse_calls_.store(0, std::memory_order_relaxed);
+    reverse_cycles_.store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  static inline void add(std::atomic<std::uint64_t>& x, std::uint64_t n) noexcept {
+    x.fetch_add(n, std::memory_order_relaxed);
+  }
+};
+
+/**
+ * Counters of the node type `Node`, only used when built with `AD_PROFILE`.
+ */
+template <typename Node>
+inline profile_counters node_profile{};
+
+}  // namespace ad
+
+#endif
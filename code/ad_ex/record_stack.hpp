@@ -0,0 +1,270 @@
+#ifndef AD_EX_RECORD_STACK_HPP
+#define AD_EX_RECORD_STACK_HPP
+
+#include <ad_ex/arena.hpp>
+#include <cstddef>
+#include <new>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#ifdef AD_PROFILE
+#include <ad_ex/profile_counters.hpp>
+#endif
+
+namespace ad {
+
+/**
+ * Reverse pass tape stored as one contiguous stream of records.
+ *
+ * Each record is a node laid out in place followed by a footer holding a
+ * function pointer that calls the node's `chain()` and the size of the
+ * record. Records are written back to back, so the reverse pass is a linear
+ * scan down the stream instead of a walk over a vector of pointers into the
+ * arena with a virtual call per node.
+ *
+ * Records only break when the arena moves on to a new chunk, which starts a
+ * new segment.
+ *
+ * Built with `AD_PROFILE`, constructing a node and calling its `chain()` are
+ * timed and added to the node type's `node_profile` counters.
+ */
+class record_stack {
+ public:
+  /**
+   * Alignment and size granularity of every record.
+   */
+  static constexpr std::size_t record_alignment = 16;
+
+  /**
+   * A position in the stream that can be swept down to or rewound to.
+   */
+  struct mark {
+    std::size_t segments_;
+    std::byte* end_;
+    arena_resource::mark arena_;
+  };
+
+  explicit record_stack(std::size_t initial_size = 1 << 16)
+      : mem_(initial_size) {}
+
+  /**
+   * Construct a record stack whose first chunk is caller owned memory.
+   * @param buffer pointer to the start of the buffer
+   * @param size size of the buffer in bytes
+   */
+  record_stack(void* buffer, std::size_t size) : mem_(buffer, size) {}
+
+  record_stack(const record_stack&) = delete;
+  record_stack& operator=(const record_stack&) = delete;
+
+  /**
+   * Construct a node at the top of the stream.
+   *
+   * The record is published before the node is constructed, so records made
+   * by the node's constructor land above it. If the constructor throws, the
+   * stream is rewound to where it was and the exception passed on, so the
+   * reverse pass never calls `chain()` on a node that does not exist.
+   * @tparam Node type of the node, which must have a `chain()` method
+   * @param args arguments forwarded to the constructor of `Node`
+   * @return pointer to the new node
+   */
+  template <typename Node, typename... Args>
+  inline Node* emplace(Args&&... args) {
+    static_assert(alignof(Node) <= record_alignment,
+                  "Over-aligned nodes can not be stored in a record_stack");
+    constexpr std::size_t bytes
+        = (sizeof(Node) + sizeof(footer) + record_alignment - 1)
+          / record_alignment * record_alignment;
+    const mark before = get_mark();
+    auto* p = static_cast<std::byte*>(mem_.allocate(bytes, record_alignment));
+    if (segments_.empty() || p != segments_.back().end_) [[unlikely]] {
+      segments_.push_back({p, p});
+    }
+    segments_.back().end_ = p + bytes;
+    new (p + bytes - sizeof(footer)) footer{&chain_record<Node>, bytes};
+    (void)&registered_name_<Node>;
+    try {
+#ifdef AD_PROFILE
+      const auto start = profile_cycles();
+      auto* node = new (p) Node(std::forward<Args>(args)...);
+      node_profile<Node>.add_forward(profile_cycles() - start);
+      return node;
+#else
+      return new (p) Node(std::forward<Args>(args)...);
+#endif
+    } catch (...) {
+      rewind(before);
+      throw;
+    }
+  }
+
+  /**
+   * @return the current top of the stream
+   */
+  inline mark get_mark() const noexcept {
+    return {segments_.size(),
+            segments_.empty() ? nullptr : segments_.back().end_,
+            mem_.get_mark()};
+  }
+
+  /**
+   * Call `chain()` on every record above `m`, newest first.
+   * @param m mark to stop at
+   */
+  inline void chain(const mark& m) const {
+    const std::size_t last = m.segments_ == 0 ? 0 : m.segments_ - 1;
+    for (std::size_t s = segments_.size(); s-- > last;) {
+      std::byte* begin = (s + 1 == m.segments_) ? m.end_ : segments_[s].begin_;
+      std::byte* p = segments_[s].end_;
+      while (p != begin) {
+        auto* f = reinterpret_cast<const footer*>(p - sizeof(footer));
+        p -= f->size_;
+        f->chain_(p);
+      }
+    }
+  }
+
+  /**
+   * Call `chain()` on every record, newest first.
+   */
+  inline void chain() const { chain(mark{0, nullptr, {}}); }
+
+  /**
+   * Drop every record above `m`, keeping the memory for reuse.
+   * @param m mark returned by `get_mark()`
+   */
+  inline void rewind(const mark& m) noexcept {
+    segments_.resize(m.segments_);
+    if (!segments_.empty()) {
+      segments_.back().end_ = m.end_;
+    }
+    mem_.rewind(m.arena_);
+  }
+
+  /**
+   * Drop every record, keeping the memory for reuse.
+   */
+  inline void clear() noexcept {
+    segments_.clear();
+    mem_.recover();
+  }
+
+  /**
+   * @return the arena records are stored in
+   */
+  inline const arena_resource& memory() const noexcept { return mem_; }
+
+  /**
+   * The function every record of one node type calls its `chain()` through,
+   * so it identifies the node type of a record.
+   */
+  using chain_fn = void (*)(void*);
+
+  /**
+   * Call `f(chain, bytes)` on every record, newest first, with the record's
+   * `chain_fn` and its size in bytes including padding and footer.
+   */
+  template <typename F>
+  inline void for_each_record(F&& f) const {
+    for (std::size_t s = segments_.size(); s-- > 0;) {
+      std::byte* p = segments_[s].end_;
+      while (p != segments_[s].begin_) {
+        auto* foot = reinterpret_cast<const footer*>(p - sizeof(footer));
+        p -= foot->size_;
+        f(foot->chain_, foot->size_);
+      }
+    }
+  }
+
+  /**
+   * @return the compiler's name for the node type that records with `chain`
+   *  belong to
+   */
+  static inline std::string_view node_name(chain_fn chain) {
+    auto it = node_names().find(chain);
+    return it == node_names().end() ? std::string_view("unknown") : it->second;
+  }
+
+#ifdef AD_PROFILE
+  /**
+   * Call `f(chain, counters)` on every node type recorded so far with its
+   * `node_profile` counters.
+   */
+  template <typename F>
+  static inline void for_each_node_profile(F&& f) {
+    for (auto&& [chain, counters] : node_profiles()) {
+      f(chain, *counters);
+    }
+  }
+#endif
+
+ private:
+  struct footer {
+    chain_fn chain_;
+    std::size_t size_;
+  };
+  static_assert(record_alignment % alignof(footer) == 0);
+
+  template <typename Node>
+  static void chain_record(void* p) {
+#ifdef AD_PROFILE
+    const auto start = profile_cycles();
+    static_cast<Node*>(p)->chain();
+    node_profile<Node>.add_reverse(profile_cycles() - start);
+#else
+    static_cast<Node*>(p)->chain();
+#endif
+  }
+
+  static inline std::unordered_map<chain_fn, std::string_view>& node_names() {
+    static std::unordered_map<chain_fn, std::string_view> names;
+    return names;
+  }
+
+#ifdef AD_PROFILE
+  static inline std::unordered_map<chain_fn, profile_counters*>& node_profiles() {
+    static std::unordered_map<chain_fn, profile_counters*> profiles;
+    return profiles;
+  }
+#endif
+
+  template <typename Node>
+  static constexpr const char* pretty_name() {
+    return __PRETTY_FUNCTION__;
+  }
+
+  /**
+   * Adds the name of `Node` to `node_names()`, and its counters to
+   * `node_profiles()`, during static initialization, so recording a node
+   * never touches the maps.
+   */
+  template <typename Node>
+  struct name_registrar {
+    name_registrar() {
+      std::string_view name = pretty_name<Node>();
+      const auto begin = name.find("Node = ");
+      if (begin != std::string_view::npos) {
+        name = name.substr(begin + 7, name.rfind(']') - begin - 7);
+      }
+      node_names().emplace(&chain_record<Node>, name);
+#ifdef AD_PROFILE
+      node_profiles().emplace(&chain_record<Node>, &node_profile<Node>);
+#endif
+    }
+  };
+  template <typename Node>
+  static inline const name_registrar<Node> registered_name_{};
+
+  struct segment {
+    std::byte* begin_;
+    std::byte* end_;
+  };
+
+  arena_resource mem_;
+  std::vector<segment> segments_;
+};
+
+}  // namespace ad
+
+#endif
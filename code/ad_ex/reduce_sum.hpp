@@ -0,0 +1,143 @@
+#ifndef AD_EX_REDUCE_SUM_HPP
+#define AD_EX_REDUCE_SUM_HPP
+
+#include <ad_ex/lambda.hpp>
+#include <ad_ex/thread_pool.hpp>
+#include <array>
+#include <cstddef>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ad {
+
+namespace detail {
+/**
+ * A fresh leaf on the current thread's tape holding the value of a shared
+ * var, so a worker never touches the caller's nodes. Non-vars pass through.
+ */
+template <typename T>
+inline auto local_copy(const T& x) {
+  if constexpr (is_var_v<T>) {
+    return var(x.val());
+  } else {
+    return x;
+  }
+}
+
+template <typename T>
+inline double local_adjoint(T& x) {
+  if constexpr (is_var_v<T>) {
+    return x.adj();
+  } else {
+    return 0.0;
+  }
+}
+
+template <typename T>
+inline void add_adjoint(T& x, double d) {
+  if constexpr (is_var_v<T>) {
+    x.adj() += d;
+  }
+}
+
+template <std::size_t N>
+struct partial_sum {
+  double value_{0};
+  std::array<double, N> grads_{};
+};
+}  // namespace detail
+
+/**
+ * The thread pool `reduce_sum()` uses when none is given, sized to the
+ * hardware concurrency. It is shared by the whole process, so concurrent
+ * `reduce_sum()` calls take turns on it and one made from inside a slice runs
+ * serially on that slice's thread, see `thread_pool`.
+ */
+inline thread_pool& default_thread_pool() {
+  static thread_pool pool;
+  return pool;
+}
+
+/**
+ * Compute `f(data[0:g], shared...) + f(data[g:2g], shared...) + ...` in
+ * parallel and record the sum as a single node on the caller's tape.
+ *
+ * Every slice of `grainsize` elements is a task on `pool`. A task records its
+ * slice in a nested region of the running thread's own tape against fresh
+ * copies of the shared vars, runs the reverse pass there and keeps only the
+ * value and the partials with respect to the shared arguments. The caller
+ * then adds up the slices in order, so the result does not depend on the
+ * number of threads or on which thread ran which slice, and records one
+ * node whose reverse pass is a multiply-add per shared var.
+ *
+ * @tparam F callable as `f(std::span<const T> slice, shared...)` returning a
+ *  `var`
+ * @tparam T element type of the data, which is not differentiated
+ * @tparam Shared `var` or arithmetic types
+ * @param pool threads to run the slices on
+ * @param f partial sum of one slice
+ * @param data terms to sum over
+ * @param grainsize number of elements per slice
+ * @param shared arguments passed to every call of `f`
+ */
+template <typename F, typename T, typename... Shared>
+requires(var_or_scalar<Shared> && ...)
+inline var reduce_sum(thread_pool& pool, const F& f,
+                      const std::vector<T>& data, std::size_t grainsize,
+                      const Shared&... shared) {
+  constexpr std::size_t n_shared = sizeof...(Shared);
+  const std::size_t grain = std::max<std::size_t>(grainsize, 1);
+  const std::size_t n_tasks = (data.size() + grain - 1) / grain;
+  std::vector<detail::partial_sum<n_shared>> partials(n_tasks);
+  pool.parallel_for(n_tasks, [&](std::size_t task) {
+    const std::size_t begin = task * grain;
+    const std::span<const T> slice(data.data() + begin,
+                                   std::min(grain, data.size() - begin));
+    nested_rev_autodiff nested;
+    auto locals = std::make_tuple(detail::local_copy(shared)...);
+    var partial = std::apply(
+        [&](auto&... local) -> var { return f(slice, local...); }, locals);
+    grad(partial);
+    auto& out = partials[task];
+    out.value_ = partial.val();
+    std::apply(
+        [&](auto&... local) {
+          std::size_t k = 0;
+          ((out.grads_[k++] = detail::local_adjoint(local)), ...);
+        },
+        locals);
+  });
+  detail::partial_sum<n_shared> total;
+  for (auto&& p : partials) {
+    total.value_ += p.value_;
+    for (std::size_t k = 0; k < n_shared; ++k) {
+      total.grads_[k] += p.grads_[k];
+    }
+  }
+  return make_var(double(total.value_), [args = std::make_tuple(shared...),
+                                         grads = total.grads_](auto&& ret) mutable {
+    std::apply(
+        [&](auto&... arg) {
+          std::size_t k = 0;
+          (detail::add_adjoint(arg, ret.adj() * grads[k++]), ...);
+        },
+        args);
+  });
+}
+
+/**
+ * `reduce_sum()` on the default thread pool.
+ */
+template <typename F, typename T, typename... Shared>
+requires(var_or_scalar<Shared> && ...)
+inline var reduce_sum(const F& f, const std::vector<T>& data,
+                      std::size_t grainsize, const Shared&... shared) {
+  return reduce_sum(default_thread_pool(), f, data, grainsize, shared...);
+}
+
+}  // namespace ad
+
+#endif
@@ -0,0 +1,269 @@
+#ifndef AD_EX_SOA_INCREMENTAL_HPP
+#define AD_EX_SOA_INCREMENTAL_HPP
+
+#include <ad_ex/soa_tape.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace ad::soa {
+
+/**
+ * A recorded function whose gradient is updated incrementally when only a
+ * few inputs change.
+ *
+ * On top of the recorded `soa::tape` this keeps, for every operand edge, the
+ * partial derivative of the operation and the adjoint contribution it sent
+ * down in the last reverse pass, plus the list of operations reading each
+ * slot.
+ *
+ * `update()` then only does work proportional to the part of the graph the
+ * change reaches:
+ *  - Forward, operations downstream of the changed inputs are recomputed in
+ *    tape order from a worklist, stopping wherever a value comes out
+ *    unchanged. Their partials are refreshed as they go.
+ *  - Reverse, starting from the operations whose partials were refreshed,
+ *    each edge sends down only the change in its contribution. Operations
+ *    whose adjoint did not move are never visited.
+ *
+ * Propagating differences can accumulate rounding error over many updates,
+ * `gradient()` recomputes everything from scratch. A guard that comes out
+ * differently also falls back to recording the function again.
+ *
+ * @tparam F callable taking `const std::vector<var>&` and returning a `var`
+ */
+template <typename F>
+class incremental_function {
+ public:
+  explicit incremental_function(F f) : f_(std::move(f)) {}
+
+  /**
+   * Record `f` at `x` and compute its value and gradient from scratch.
+   * @param x input values
+   * @return value of `f` at `x`
+   */
+  inline double gradient(std::span<const double> x) {
+    record(x);
+    full_sweep();
+    return tape_.values_[out_];
+  }
+
+  /**
+   * Update the value and gradient after the inputs listed in `changed` took
+   * new values. `gradient()` must have been called first.
+   * @param changed indices of the inputs that changed
+   * @param x all input values, only the entries in `changed` are read
+   * @return value of `f` at `x`
+   */
+  inline double update(std::span<const std::size_t> changed,
+                       std::span<const double> x) {
+    double* v = tape_.values_.data();
+    for (auto i : changed) {
+      if (v[i] != x[i]) {
+        v[i] = x[i];
+        push_users(static_cast<std::uint32_t>(i));
+      }
+    }
+    if (!forward_dirty()) {
+      std::vector<double> all(v, v + n_);
+      return gradient(all);
+    }
+    reverse_dirty();
+    return v[out_];
+  }
+
+  /**
+   * @return gradient from the last `gradient()` or `update()`
+   */
+  inline std::span<const double> grad() const noexcept {
+    return {tape_.adjoints_.data(), n_};
+  }
+
+  /**
+   * @return number of operations recomputed by the last `update()`
+   */
+  inline std::size_t last_forward_ops() const noexcept { return fwd_ops_; }
+
+  /**
+   * @return number of operations swept by the last `update()`
+   */
+  inline std::size_t last_reverse_ops() const noexcept { return rev_ops_; }
+
+ private:
+  inline void record(std::span<const double> x) {
+    tape_.clear();
+    {
+      tape_scope scope(tape_);
+      std::vector<var> xs;
+      xs.reserve(x.size());
+      for (auto x_i : x) {
+        xs.emplace_back(x_i);
+      }
+      out_ = var(f_(xs)).idx_;
+    }
+    n_ = x.size();
+    const std::size_t n_ops = tape_.ops_.size();
+    arg_begin_.resize(n_ops + 1);
+    const_begin_.resize(n_ops + 1);
+    std::vector<std::uint32_t> n_users(n_ops + 1, 0);
+    std::uint32_t a = 0;
+    std::uint32_t c = 0;
+    for (std::size_t i = 0; i < n_ops; ++i) {
+      arg_begin_[i] = a;
+      const_begin_[i] = c;
+      const op code = tape_.ops_[i];
+      for (std::uint32_t j = 0; j < num_args(code); ++j) {
+        ++n_users[tape_.args_[a + j] + 1];
+      }
+      a += num_args(code);
+      c += num_consts(code);
+    }
+    arg_begin_[n_ops] = a;
+    const_begin_[n_ops] = c;
+    // Users of each slot in compressed row form, in ascending op order.
+    for (std::size_t i = 0; i < n_ops; ++i) {
+      n_users[i + 1] += n_users[i];
+    }
+    users_begin_ = n_users;
+    users_.resize(a);
+    for (std::size_t i = 0; i < n_ops; ++i) {
+      for (std::uint32_t e = arg_begin_[i]; e < arg_begin_[i + 1]; ++e) {
+        users_[n_users[tape_.args_[e]]++] = static_cast<std::uint32_t>(i);
+      }
+    }
+    partials_.resize(a);
+    contrib_.resize(a);
+    // A guard flip lands here from update() with operations still queued,
+    // their indices refer to the old tape.
+    fwd_queued_.assign(n_ops, 0);
+    rev_queued_.assign(n_ops, 0);
+    fwd_queue_ = {};
+    rev_queue_ = {};
+  }
+
+  inline void refresh_partials(std::size_t i) {
+    const op code = tape_.ops_[i];
+    partials(code, tape_.values_[i], tape_.values_.data(),
+             tape_.args_.data() + arg_begin_[i],
+             tape_.consts_.data() + const_begin_[i],
+             partials_.data() + arg_begin_[i]);
+  }
+
+  inline void full_sweep() {
+    const std::size_t n_ops = tape_.ops_.size();
+    for (std::size_t i = 0; i < n_ops; ++i) {
+      refresh_partials(i);
+    }
+    tape_.zero_adjoints();
+    double* adj = tape_.adjoints_.data();
+    adj[out_] = 1.0;
+    for (std::size_t i = n_ops; i-- > 0;) {
+      for (std::uint32_t e = arg_begin_[i]; e < arg_begin_[i + 1]; ++e) {
+        contrib_[e] = partials_[e] * adj[i];
+        adj[tape_.args_[e]] += contrib_[e];
+      }
+    }
+  }
+
+  inline void push_users(std::uint32_t slot) {
+    for (std::uint32_t u = users_begin_[slot]; u < users_begin_[slot + 1]; ++u) {
+      const auto i = users_[u];
+      if (!fwd_queued_[i]) {
+        fwd_queued_[i] = 1;
+        fwd_queue_.push(i);
+      }
+    }
+  }
+
+  /**
+   * Recompute the operations downstream of the changed inputs.
+   * @return false if a guard came out differently
+   */
+  inline bool forward_dirty() {
+    double* v = tape_.values_.data();
+    bool valid = true;
+    fwd_ops_ = 0;
+    while (!fwd_queue_.empty()) {
+      const auto i = fwd_queue_.top();
+      fwd_queue_.pop();
+      fwd_queued_[i] = 0;
+      ++fwd_ops_;
+      const op code = tape_.ops_[i];
+      const double x = eval(code, v, tape_.args_.data() + arg_begin_[i],
+                            tape_.consts_.data() + const_begin_[i]);
+      if (is_guard(code)) {
+        valid &= x == v[i];
+        continue;
+      }
+      const bool changed = x != v[i];
+      v[i] = x;
+      refresh_partials(i);
+      push_reverse(i);
+      if (changed) {
+        push_users(i);
+      }
+    }
+    return valid;
+  }
+
+  /**
+   * Send down the change in adjoint contributions, newest operation first.
+   */
+  inline void reverse_dirty() {
+    double* adj = tape_.adjoints_.data();
+    rev_ops_ = 0;
+    while (!rev_queue_.empty()) {
+      const auto i = rev_queue_.top();
+      rev_queue_.pop();
+      rev_queued_[i] = 0;
+      ++rev_ops_;
+      for (std::uint32_t e = arg_begin_[i]; e < arg_begin_[i + 1]; ++e) {
+        const double c = partials_[e] * adj[i];
+        const double delta = c - contrib_[e];
+        if (delta != 0.0) {
+          contrib_[e] = c;
+          const auto slot = tape_.args_[e];
+          adj[slot] += delta;
+          if (tape_.ops_[slot] != op::input) {
+            push_reverse(slot);
+          }
+        }
+      }
+    }
+  }
+
+  inline void push_reverse(std::uint32_t i) {
+    if (!rev_queued_[i]) {
+      rev_queued_[i] = 1;
+      rev_queue_.push(i);
+    }
+  }
+
+  F f_;
+  tape tape_;
+  std::uint32_t out_{0};
+  std::size_t n_{0};
+  std::vector<std::uint32_t> arg_begin_;
+  std::vector<std::uint32_t> const_begin_;
+  std::vector<std::uint32_t> users_begin_;
+  std::vector<std::uint32_t> users_;
+  std::vector<double> partials_;
+  std::vector<double> contrib_;
+  std::vector<std::uint8_t> fwd_queued_;
+  std::vector<std::uint8_t> rev_queued_;
+  std::priority_queue<std::uint32_t, std::vector<std::uint32_t>,
+                      std::greater<>>
+      fwd_queue_;
+  std::priority_queue<std::uint32_t> rev_queue_;
+  std::size_t fwd_ops_{0};
+  std::size_t rev_ops_{0};
+};
+
+}  // namespace ad::soa
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef AD_EX_SOA_JACOBIAN_HPP
+#define AD_EX_SOA_JACOBIAN_HPP
+
+#include <ad_ex/soa_tape.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace ad::soa {
+
+/**
+ * Which way `jacobian()` sweeps the tape.
+ */
+enum class jacobian_mode {
+  /**
+   * Forward when there are fewer inputs than outputs, reverse otherwise.
+   */
+  automatic,
+  /**
+   * One tangent sweep per input, giving a column each.
+   */
+  forward,
+  /**
+   * One adjoint sweep per output, giving a row each.
+   */
+  reverse
+};
+
+/**
+ * Compute the value and Jacobian of `f` at `x`.
+ *
+ * `f` is recorded once. The partial derivative of every operation with
+ * respect to each of its operands is then evaluated once into a flat edge
+ * list, so each sweep is only multiply-adds over that list with no calls to
+ * transcendental functions:
+ *  - Reverse mode seeds one output, sweeps down from it and reads a row off
+ *    the input adjoints. Adjoints are zeroed in bulk between rows.
+ *  - Forward mode seeds one input, sweeps up from it and reads a column off
+ *    the output tangents.
+ *
+ * @tparam F callable taking `const std::vector<var>&` and returning a
+ *  `std::vector<var>`
+ * @param f function to differentiate
+ * @param x input values
+ * @param[out] fx values of the outputs of `f` at `x`
+ * @param[out] J row major Jacobian, `J[i * x.size() + j]` is the derivative
+ *  of output `i` with respect to input `j`
+ * @param mode sweep direction
+ */
+template <typename F>
+inline void jacobian(const F& f, std::span<const double> x,
+                     std::vector<double>& fx, std::vector<double>& J,
+                     jacobian_mode mode = jacobian_mode::automatic) {
+  tape t;
+  std::vector<std::uint32_t> outs;
+  {
+    tape_scope scope(t);
+    std::vector<var> xs;
+    xs.reserve(x.size());
+    for (auto x_i : x) {
+      xs.emplace_back(x_i);
+    }
+    for (auto&& y : f(xs)) {
+      outs.push_back(y.idx_);
+    }
+  }
+  const std::size_t n = x.size();
+  const std::size_t m = outs.size();
+  const std::size_t n_ops = t.ops_.size();
+  fx.resize(m);
+  for (std::size_t i = 0; i < m; ++i) {
+    fx[i] = t.values_[outs[i]];
+  }
+  J.assign(m * n, 0.0);
+
+  // Linearize: partials of every operation, edges in tape order.
+  std::vector<std::uint32_t> arg_begin(n_ops + 1);
+  std::vector<double> d(t.args_.size());
+  {
+    std::uint32_t a = 0;
+    std::uint32_t c = 0;
+    for (std::size_t i = 0; i < n_ops; ++i) {
+      const op code = t.ops_[i];
+      arg_begin[i] = a;
+      partials(code, t.values_[i], t.values_.data(), t.args_.data() + a,
+               t.consts_.data() + c, d.data() + a);
+      a += num_args(code);
+      c += num_consts(code);
+    }
+    arg_begin[n_ops] = a;
+  }
+  const std::uint32_t* args = t.args_.data();
+
+  if (mode == jacobian_mode::automatic) {
+    mode = n < m ? jacobian_mode::forward : jacobian_mode::reverse;
+  }
+  if (mode == jacobian_mode::reverse) {
+    std::vector<double> adj(n_ops);
+    for (std::size_t r = 0; r < m; ++r) {
+      std::fill(adj.begin(), adj.end(), 0.0);
+      adj[outs[r]] = 1.0;
+      for (std::size_t i = outs[r] + 1; i-- > n;) {
+        const double a_i = adj[i];
+        if (a_i == 0.0) {
+          continue;
+        }
+        for (std::uint32_t e = arg_begin[i]; e < arg_begin[i + 1]; ++e) {
+          adj[args[e]] += d[e] * a_i;
+        }
+      }
+      std::copy_n(adj.begin(), n, J.begin() + r * n);
+    }
+  } else {
+    std::vector<double> dot(n_ops);
+    for (std::size_t j = 0; j < n; ++j) {
+      std::fill(dot.begin(), dot.end(), 0.0);
+      dot[j] = 1.0;
+      for (std::size_t i = n; i < n_ops; ++i) {
+        double dot_i = 0.0;
+        for (std::uint32_t e = arg_begin[i]; e < arg_begin[i + 1]; ++e) {
+          dot_i += d[e] * dot[args[e]];
+        }
+        dot[i] = dot_i;
+      }
+      for (std::size_t r = 0; r < m; ++r) {
+        J[r * n + j] = dot[outs[r]];
+      }
+    }
+  }
+}
+
+}  // namespace ad::soa
+
+#endif
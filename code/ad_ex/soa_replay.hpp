@@ -0,0 +1,102 @@
+#ifndef AD_EX_SOA_REPLAY_HPP
+#define AD_EX_SOA_REPLAY_HPP
+
+#include <ad_ex/soa_tape.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace ad::soa {
+
+/**
+ * A function recorded once onto its own `soa::tape` and replayed for new
+ * inputs.
+ *
+ * The first call records `f` at the given inputs. Later calls write the new
+ * inputs into the input slots, rerun the forward pass over the opcode stream
+ * and sweep the reverse pass, without any allocation or re-recording. If a
+ * guard (a comparison between vars) comes out differently for the new inputs
+ * the control flow of `f` would have changed, so the tape is recorded again at
+ * those inputs.
+ *
+ * Control flow that depends on `val()` rather than on var comparisons is not
+ * seen by the guards and must not change between calls.
+ *
+ * @tparam F callable taking `const std::vector<var>&` and returning a `var`
+ */
+template <typename F>
+class recorded_function {
+ public:
+  explicit recorded_function(F f) : f_(std::move(f)) {}
+
+  /**
+   * Replay the tape forward at `x` without re-recording.
+   * @param x input values
+   * @return false if the tape was never recorded for this many inputs or a
+   * guard came out differently, meaning the tape does not describe `f` at `x`
+   */
+  inline bool forward(std::span<const double> x) {
+    if (!recorded_ || x.size() != n_) {
+      return false;
+    }
+    std::copy(x.begin(), x.end(), tape_.values_.begin());
+    return tape_.forward();
+  }
+
+  /**
+   * Compute the value and gradient of `f` at `x`, replaying the recorded tape
+   * when it is still valid and recording it again otherwise.
+   * @param x input values
+   * @param[out] grad gradient of `f` at `x`, of the same size as `x`
+   * @return value of `f` at `x`
+   */
+  inline double gradient(std::span<const double> x, std::span<double> grad) {
+    if (!forward(x)) {
+      record(x);
+    }
+    tape_.zero_adjoints();
+    tape_.adjoints_[out_] = 1.0;
+    tape_.reverse();
+    std::copy_n(tape_.adjoints_.begin(), n_, grad.begin());
+    return tape_.values_[out_];
+  }
+
+  /**
+   * @return number of times `f` has been recorded
+   */
+  inline std::size_t recordings() const noexcept { return recordings_; }
+
+  /**
+   * @return the recorded tape
+   */
+  inline const tape& get_tape() const noexcept { return tape_; }
+
+ private:
+  inline void record(std::span<const double> x) {
+    tape_.clear();
+    tape_scope scope(tape_);
+    std::vector<var> xs;
+    xs.reserve(x.size());
+    for (auto x_i : x) {
+      xs.emplace_back(x_i);
+    }
+    out_ = var(f_(xs)).idx_;
+    n_ = x.size();
+    recorded_ = true;
+    ++recordings_;
+  }
+
+  F f_;
+  tape tape_;
+  std::uint32_t out_{0};
+  std::size_t n_{0};
+  bool recorded_{false};
+  std::size_t recordings_{0};
+};
+
+}  // namespace ad::soa
+
+#endif
@@ -0,0 +1,617 @@
+#ifndef AD_EX_SOA_TAPE_HPP
+#define AD_EX_SOA_TAPE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Index based structure-of-arrays scalar tape (a Wengert list).
+ *
+ * Every scalar is a 32-bit index into two contiguous `double` arrays, one of
+ * values and one of adjoints. The operations are kept in a separate compact
+ * stream of one byte opcodes plus their operand indices and any constants.
+ * Slot `i` of the value and adjoint arrays is the result of operation `i`, so
+ * the output index of an operation is implicit and inputs are recorded as an
+ * `input` opcode that does nothing in the reverse pass.
+ *
+ * Compared to the pointer based nodes in `lambda.hpp` there is no vtable,
+ * no operand pointers and no per node allocation. Zeroing adjoints is a
+ * single fill over one array and the reverse pass is a switch over a dense
+ * byte stream.
+ *
+ * Because the stream fully describes the computation, a tape can also be
+ * replayed forward for new input values (see `soa_replay.hpp`). Comparisons
+ * between vars are recorded as guards so a replay can detect when control
+ * flow would have gone another way.
+ */
+namespace ad::soa {
+
+enum class op : std::uint8_t {
+  input,
+  add_vv,
+  add_vd,
+  sub_vv,
+  sub_vd,
+  sub_dv,
+  mul_vv,
+  mul_vd,
+  div_vv,
+  div_vd,
+  div_dv,
+  neg,
+  square,
+  sqrt,
+  exp,
+  log,
+  sin,
+  cos,
+  pow_vd,
+  guard_lt,
+  guard_le,
+  guard_eq
+};
+
+/**
+ * @return true if `code` is a recorded comparison
+ */
+inline constexpr bool is_guard(op code) {
+  return code == op::guard_lt || code == op::guard_le || code == op::guard_eq;
+}
+
+namespace detail {
+// Operand index and constant counts of each op, in enum order.
+inline constexpr std::uint8_t op_args[] = {0, 2, 1, 2, 1, 1, 2, 1, 2, 1, 1,
+                                           1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1};
+inline constexpr std::uint8_t op_consts[] = {0, 0, 1, 0, 1, 1, 0, 1, 0, 1, 1,
+                                             0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0};
+static_assert(sizeof(op_args) == static_cast<std::size_t>(op::guard_eq) + 1);
+static_assert(sizeof(op_consts) == static_cast<std::size_t>(op::guard_eq) + 1);
+}  // namespace detail
+
+/**
+ * @return number of operand indices `code` reads
+ */
+inline constexpr std::uint32_t num_args(op code) {
+  return detail::op_args[static_cast<std::size_t>(code)];
+}
+
+/**
+ * @return number of constants `code` reads
+ */
+inline constexpr std::uint32_t num_consts(op code) {
+  return detail::op_consts[static_cast<std::size_t>(code)];
+}
+
+/**
+ * Evaluate one operation. Guards return their outcome as 1 or 0.
+ * @param code operation
+ * @param v values
+ * @param arg operand indices of the operation
+ * @param c constants of the operation
+ */
+inline double eval(op code, const double* v, const std::uint32_t* arg,
+                   const double* c) {
+  switch (code) {
+    case op::add_vv:
+      return v[arg[0]] + v[arg[1]];
+    case op::add_vd:
+      return v[arg[0]] + c[0];
+    case op::sub_vv:
+      return v[arg[0]] - v[arg[1]];
+    case op::sub_vd:
+      return v[arg[0]] - c[0];
+    case op::sub_dv:
+      return c[0] - v[arg[0]];
+    case op::mul_vv:
+      return v[arg[0]] * v[arg[1]];
+    case op::mul_vd:
+      return v[arg[0]] * c[0];
+    case op::div_vv:
+      return v[arg[0]] / v[arg[1]];
+    case op::div_vd:
+      return v[arg[0]] / c[0];
+    case op::div_dv:
+      return c[0] / v[arg[0]];
+    case op::neg:
+      return -v[arg[0]];
+    case op::square:
+      return v[arg[0]] * v[arg[0]];
+    case op::sqrt:
+      return std::sqrt(v[arg[0]]);
+    case op::exp:
+      return std::exp(v[arg[0]]);
+    case op::log:
+      return std::log(v[arg[0]]);
+    case op::sin:
+      return std::sin(v[arg[0]]);
+    case op::cos:
+      return std::cos(v[arg[0]]);
+    case op::pow_vd:
+      return std::pow(v[arg[0]], c[0]);
+    case op::guard_lt:
+      return v[arg[0]] < 0.0 ? 1.0 : 0.0;
+    case op::guard_le:
+      return v[arg[0]] <= 0.0 ? 1.0 : 0.0;
+    case op::guard_eq:
+      return v[arg[0]] == 0.0 ? 1.0 : 0.0;
+    case op::input:
+    default:
+      return 0.0;
+  }
+}
+
+/**
+ * Partial derivatives of one operation with respect to each of its operands.
+ * @param code operation
+ * @param val value of the operation
+ * @param v values
+ * @param arg operand indices of the operation
+ * @param c constants of the operation
+ * @param[out] d one partial per operand index
+ */
+inline void partials(op code, double val, const double* v,
+                     const std::uint32_t* arg, const double* c, double* d) {
+  switch (code) {
+    case op::add_vv:
+      d[0] = 1.0;
+      d[1] = 1.0;
+      break;
+    case op::sub_vv:
+      d[0] = 1.0;
+      d[1] = -1.0;
+      break;
+    case op::mul_vv:
+      d[0] = v[arg[1]];
+      d[1] = v[arg[0]];
+      break;
+    case op::div_vv:
+      d[0] = 1.0 / v[arg[1]];
+      d[1] = -val / v[arg[1]];
+      break;
+    case op::add_vd:
+    case op::sub_vd:
+      d[0] = 1.0;
+      break;
+    case op::sub_dv:
+    case op::neg:
+      d[0] = -1.0;
+      break;
+    case op::mul_vd:
+      d[0] = c[0];
+      break;
+    case op::div_vd:
+      d[0] = 1.0 / c[0];
+      break;
+    case op::div_dv:
+      d[0] = -val / v[arg[0]];
+      break;
+    case op::square:
+      d[0] = 2.0 * v[arg[0]];
+      break;
+    case op::sqrt:
+      d[0] = 0.5 / val;
+      break;
+    case op::exp:
+      d[0] = val;
+      break;
+    case op::log:
+      d[0] = 1.0 / v[arg[0]];
+      break;
+    case op::sin:
+      d[0] = std::cos(v[arg[0]]);
+      break;
+    case op::cos:
+      d[0] = -std::sin(v[arg[0]]);
+      break;
+    case op::pow_vd:
+      d[0] = c[0] * std::pow(v[arg[0]], c[0] - 1.0);
+      break;
+    case op::guard_lt:
+    case op::guard_le:
+    case op::guard_eq:
+      d[0] = 0.0;
+      break;
+    case op::input:
+      break;
+  }
+}
+
+struct var;
+
+struct tape {
+  std::vector<double> values_;
+  std::vector<double> adjoints_;
+  std::vector<op> ops_;
+  std::vector<std::uint32_t> args_;
+  std::vector<double> consts_;
+
+  /**
+   * @return number of slots (and operations) on the tape
+   */
+  inline std::uint32_t size() const noexcept {
+    return static_cast<std::uint32_t>(ops_.size());
+  }
+
+  inline std::uint32_t push_input(double x) {
+    ops_.push_back(op::input);
+    values_.push_back(x);
+    return size() - 1;
+  }
+
+  inline std::uint32_t push(op code, double val, std::uint32_t x) {
+    ops_.push_back(code);
+    args_.push_back(x);
+    values_.push_back(val);
+    return size() - 1;
+  }
+
+  inline std::uint32_t push(op code, double val, std::uint32_t x,
+                            std::uint32_t y) {
+    ops_.push_back(code);
+    args_.push_back(x);
+    args_.push_back(y);
+    values_.push_back(val);
+    return size() - 1;
+  }
+
+  inline std::uint32_t push(op code, double val, std::uint32_t x, double c) {
+    ops_.push_back(code);
+    args_.push_back(x);
+    consts_.push_back(c);
+    values_.push_back(val);
+    return size() - 1;
+  }
+
+  /**
+   * Recompute every value from the inputs, which must already be written into
+   * their slots.
+   * @return false if a guard recorded a different comparison outcome, in which
+   * case the values no longer describe the function
+   */
+  inline bool forward() {
+    double* v = values_.data();
+    const std::uint32_t* arg = args_.data();
+    const double* c = consts_.data();
+    bool valid = true;
+    const std::size_t n = ops_.size();
+    for (std::size_t i = 0; i < n; ++i) {
+      const op code = ops_[i];
+      if (code == op::input) {
+        continue;
+      }
+      const double x = eval(code, v, arg, c);
+      if (is_guard(code)) {
+        valid &= x == v[i];
+      } else {
+        v[i] = x;
+      }
+      arg += num_args(code);
+      c += num_consts(code);
+    }
+    return valid;
+  }
+
+  /**
+   * Set every adjoint to zero.
+   */
+  inline void zero_adjoints() {
+    adjoints_.resize(values_.size());
+    std::fill(adjoints_.begin(), adjoints_.end(), 0.0);
+  }
+
+  /**
+   * Propagate adjoints from the last slot down to the first.
+   */
+  inline void reverse() {
+    const double* v = values_.data();
+    double* a = adjoints_.data();
+    const std::uint32_t* arg = args_.data() + args_.size();
+    const double* c = consts_.data() + consts_.size();
+    for (std::size_t i = ops_.size(); i-- > 0;) {
+      const double adj = a[i];
+      switch (ops_[i]) {
+        case op::input:
+          break;
+        case op::add_vv:
+          arg -= 2;
+          a[arg[0]] += adj;
+          a[arg[1]] += adj;
+          break;
+        case op::add_vd:
+          arg -= 1;
+          c -= 1;
+          a[arg[0]] += adj;
+          break;
+        case op::sub_vv:
+          arg -= 2;
+          a[arg[0]] += adj;
+          a[arg[1]] -= adj;
+          break;
+        case op::sub_vd:
+          arg -= 1;
+          c -= 1;
+          a[arg[0]] += adj;
+          break;
+        case op::sub_dv:
+          arg -= 1;
+          c -= 1;
+          a[arg[0]] -= adj;
+          break;
+        case op::mul_vv:
+          arg -= 2;
+          a[arg[0]] += adj * v[arg[1]];
+          a[arg[1]] += adj * v[arg[0]];
+          break;
+        case op::mul_vd:
+          arg -= 1;
+          c -= 1;
+          a[arg[0]] += adj * c[0];
+          break;
+        case op::div_vv:
+          arg -= 2;
+          a[arg[0]] += adj / v[arg[1]];
+          a[arg[1]] -= adj * v[i] / v[arg[1]];
+          break;
+        case op::div_vd:
+          arg -= 1;
+          c -= 1;
+          a[arg[0]] += adj / c[0];
+          break;
+        case op::div_dv:
+          arg -= 1;
+          c -= 1;
+          a[arg[0]] -= adj * v[i] / v[arg[0]];
+          break;
+        case op::neg:
+          arg -= 1;
+          a[arg[0]] -= adj;
+          break;
+        case op::square:
+          arg -= 1;
+          a[arg[0]] += 2.0 * adj * v[arg[0]];
+          break;
+        case op::sqrt:
+          arg -= 1;
+          a[arg[0]] += 0.5 * adj / v[i];
+          break;
+        case op::exp:
+          arg -= 1;
+          a[arg[0]] += adj * v[i];
+          break;
+        case op::log:
+          arg -= 1;
+          a[arg[0]] += adj / v[arg[0]];
+          break;
+        case op::sin:
+          arg -= 1;
+          a[arg[0]] += adj * std::cos(v[arg[0]]);
+          break;
+        case op::cos:
+          arg -= 1;
+          a[arg[0]] -= adj * std::sin(v[arg[0]]);
+          break;
+        case op::pow_vd:
+          arg -= 1;
+          c -= 1;
+          a[arg[0]] += adj * c[0] * std::pow(v[arg[0]], c[0] - 1.0);
+          break;
+        case op::guard_lt:
+        case op::guard_le:
+        case op::guard_eq:
+          arg -= 1;
+          break;
+      }
+    }
+  }
+
+  /**
+   * Drop every slot, keeping the capacity of all arrays for reuse.
+   */
+  inline void clear() noexcept {
+    values_.clear();
+    adjoints_.clear();
+    ops_.clear();
+    args_.clear();
+    consts_.clear();
+  }
+
+  /**
+   * @return bytes of tape storage currently in use
+   */
+  inline std::size_t bytes() const noexcept {
+    return values_.size() * sizeof(double) * 2 + ops_.size() * sizeof(op)
+           + args_.size() * sizeof(std::uint32_t)
+           + consts_.size() * sizeof(double);
+  }
+};
+
+namespace detail {
+inline thread_local tape* active_tape = nullptr;
+}
+
+/**
+ * @return the tape new operations on this thread are recorded to
+ */
+inline tape& get_tape() {
+  if (!detail::active_tape) [[unlikely]] {
+    thread_local tape t;
+    detail::active_tape = &t;
+  }
+  return *detail::active_tape;
+}
+
+/**
+ * Makes a tape the active tape of this thread until the scope exits.
+ */
+struct tape_scope {
+  tape* prev_;
+  explicit tape_scope(tape& t) : prev_(detail::active_tape) {
+    detail::active_tape = &t;
+  }
+  tape_scope(const tape_scope&) = delete;
+  tape_scope& operator=(const tape_scope&) = delete;
+  ~tape_scope() { detail::active_tape = prev_; }
+};
+
+/**
+ * Scalar recorded on the thread's `soa::tape`.
+ */
+struct var {
+  struct index_tag {};
+  std::uint32_t idx_;
+
+  var(double x) : idx_(get_tape().push_input(x)) {}  // NOLINT
+  var(std::uint32_t idx, index_tag) : idx_(idx) {}
+
+  inline double val() const { return get_tape().values_[idx_]; }
+  inline double& adj() { return get_tape().adjoints_[idx_]; }
+  inline var& operator+=(var x);
+};
+
+namespace detail {
+inline var make_var(std::uint32_t idx) { return var(idx, var::index_tag{}); }
+}  // namespace detail
+
+inline double value(var x) { return x.val(); }
+inline double value(double x) { return x; }
+
+inline var operator+(var x, var y) {
+  return detail::make_var(
+      get_tape().push(op::add_vv, x.val() + y.val(), x.idx_, y.idx_));
+}
+inline var operator+(var x, double c) {
+  return detail::make_var(get_tape().push(op::add_vd, x.val() + c, x.idx_, c));
+}
+inline var operator+(double c, var x) { return x + c; }
+
+inline var operator-(var x, var y) {
+  return detail::make_var(
+      get_tape().push(op::sub_vv, x.val() - y.val(), x.idx_, y.idx_));
+}
+inline var operator-(var x, double c) {
+  return detail::make_var(get_tape().push(op::sub_vd, x.val() - c, x.idx_, c));
+}
+inline var operator-(double c, var x) {
+  return detail::make_var(get_tape().push(op::sub_dv, c - x.val(), x.idx_, c));
+}
+inline var operator-(var x) {
+  return detail::make_var(get_tape().push(op::neg, -x.val(), x.idx_));
+}
+
+inline var operator*(var x, var y) {
+  return detail::make_var(
+      get_tape().push(op::mul_vv, x.val() * y.val(), x.idx_, y.idx_));
+}
+inline var operator*(var x, double c) {
+  return detail::make_var(get_tape().push(op::mul_vd, x.val() * c, x.idx_, c));
+}
+inline var operator*(double c, var x) { return x * c; }
+
+inline var operator/(var x, var y) {
+  return detail::make_var(
+      get_tape().push(op::div_vv, x.val() / y.val(), x.idx_, y.idx_));
+}
+inline var operator/(var x, double c) {
+  return detail::make_var(get_tape().push(op::div_vd, x.val() / c, x.idx_, c));
+}
+inline var operator/(double c, var x) {
+  return detail::make_var(get_tape().push(op::div_dv, c / x.val(), x.idx_, c));
+}
+
+inline var& var::operator+=(var x) {
+  *this = *this + x;
+  return *this;
+}
+
+template <typename T1, typename T2>
+concept any_var = std::same_as<T1, var> || std::same_as<T2, var>;
+
+namespace detail {
+/**
+ * Record the sign test `code` on the difference `d` of two operands and
+ * return its outcome.
+ */
+inline bool guard(op code, var d) {
+  const double x = d.val();
+  const bool outcome = code == op::guard_lt   ? x < 0.0
+                       : code == op::guard_le ? x <= 0.0
+                                              : x == 0.0;
+  get_tape().push(code, outcome ? 1.0 : 0.0, d.idx_);
+  return outcome;
+}
+}  // namespace detail
+
+template <typename T1, typename T2>
+requires any_var<T1, T2>
+inline bool operator<(const T1& x, const T2& y) {
+  return detail::guard(op::guard_lt, x - y);
+}
+template <typename T1, typename T2>
+requires any_var<T1, T2>
+inline bool operator>(const T1& x, const T2& y) {
+  return detail::guard(op::guard_lt, y - x);
+}
+template <typename T1, typename T2>
+requires any_var<T1, T2>
+inline bool operator<=(const T1& x, const T2& y) {
+  return detail::guard(op::guard_le, x - y);
+}
+template <typename T1, typename T2>
+requires any_var<T1, T2>
+inline bool operator>=(const T1& x, const T2& y) {
+  return detail::guard(op::guard_le, y - x);
+}
+template <typename T1, typename T2>
+requires any_var<T1, T2>
+inline bool operator==(const T1& x, const T2& y) {
+  return detail::guard(op::guard_eq, x - y);
+}
+template <typename T1, typename T2>
+requires any_var<T1, T2>
+inline bool operator!=(const T1& x, const T2& y) {
+  return !(x == y);
+}
+
+inline var square(var x) {
+  return detail::make_var(
+      get_tape().push(op::square, x.val() * x.val(), x.idx_));
+}
+inline var sqrt(var x) {
+  return detail::make_var(get_tape().push(op::sqrt, std::sqrt(x.val()), x.idx_));
+}
+inline var exp(var x) {
+  return detail::make_var(get_tape().push(op::exp, std::exp(x.val()), x.idx_));
+}
+inline var log(var x) {
+  return detail::make_var(get_tape().push(op::log, std::log(x.val()), x.idx_));
+}
+inline var sin(var x) {
+  return detail::make_var(get_tape().push(op::sin, std::sin(x.val()), x.idx_));
+}
+inline var cos(var x) {
+  return detail::make_var(get_tape().push(op::cos, std::cos(x.val()), x.idx_));
+}
+inline var pow(var x, double c) {
+  return detail::make_var(
+      get_tape().push(op::pow_vd, std::pow(x.val(), c), x.idx_, c));
+}
+
+/**
+ * Run the reverse pass from `z`. Adjoints of every slot are zeroed first.
+ */
+inline void grad(var z) {
+  auto& t = get_tape();
+  t.zero_adjoints();
+  t.adjoints_[z.idx_] = 1.0;
+  t.reverse();
+}
+
+inline void clear_mem() { get_tape().clear(); }
+
+}  // namespace ad::soa
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef AD_EX_TAPE_HPP
+#define AD_EX_TAPE_HPP
+
+#include <ad_ex/arena.hpp>
+#include <ad_ex/record_stack.hpp>
+#include <array>
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+namespace ad {
+
+using alloc_t = std::pmr::polymorphic_allocator<std::byte>;
+
+/**
+ * Everything one gradient evaluation records: the arena leaves and matrix
+ * storage live in and the stream of nodes to call `chain()` on in the
+ * reverse pass.
+ *
+ * Every thread gets its own tape by default (see `get_tape()`), so
+ * independent gradients can run concurrently on separate threads. A tape can
+ * also be made active explicitly for a scope with `tape_scope`. Vars must only
+ * be used with the tape they were created on.
+ */
+struct tape {
+  /**
+   * Where a nested region started, see `start_nested()`.
+   */
+  struct nested_mark {
+    arena_resource::mark arena_;
+    record_stack::mark records_;
+  };
+  arena_resource mbr_;
+  alloc_t pa_{&mbr_};
+  record_stack records_;
+  std::vector<nested_mark> nested_;
+
+  /**
+   * Construct a tape whose arena and record stream each start with
+   * `initial_size` bytes.
+   * @param initial_size size in bytes of the first chunks
+   */
+  explicit tape(std::size_t initial_size = 8192)
+      : mbr_(initial_size), records_(initial_size) {}
+
+  tape(const tape&) = delete;
+  tape& operator=(const tape&) = delete;
+
+ protected:
+  /**
+   * Construct a tape over caller owned storage.
+   * @param buffer memory used as the first arena chunk
+   * @param size size of `buffer` in bytes
+   * @param record_buffer memory used as the first record stream chunk
+   * @param record_size size of `record_buffer` in bytes
+   */
+  tape(void* buffer, std::size_t size, void* record_buffer,
+       std::size_t record_size)
+      : mbr_(buffer, size), records_(record_buffer, record_size) {}
+};
+
+namespace detail {
+template <std::size_t Bytes, std::size_t RecordBytes>
+struct stack_tape_storage {
+  alignas(arena_resource::chunk_alignment) std::array<std::byte, Bytes> arena_buf_;
+  alignas(arena_resource::chunk_alignment) std::array<std::byte, RecordBytes> record_buf_;
+};
+}  // namespace detail
+
+/**
+ * Tape with a fixed amount of inline storage, meant to live on the caller's
+ * stack. The first `Bytes` bytes of leaves and the first `RecordBytes` bytes
+ * of nodes need no heap allocation at all. Going over either spills to the
+ * heap instead of failing.
+ * @tparam Bytes size of the inline arena buffer
+ * @tparam RecordBytes size of the inline record stream buffer
+ */
+template <std::size_t Bytes = 4096, std::size_t RecordBytes = 8192>
+struct stack_tape : private detail::stack_tape_storage<Bytes, RecordBytes>,
+                    public tape {
+  stack_tape()
+      : detail::stack_tape_storage<Bytes, RecordBytes>(),
+        tape(this->arena_buf_.data(), Bytes, this->record_buf_.data(),
+             RecordBytes) {}
+};
+
+namespace detail {
+inline thread_local tape* active_tape = nullptr;
+}
+
+/**
+ * @return this thread's default tape
+ */
+inline tape& default_tape() {
+  thread_local tape t;
+  return t;
+}
+
+/**
+ * @return the tape new nodes on this thread are recorded to
+ */
+inline tape& get_tape() {
+  if (!detail::active_tape) [[unlikely]] {
+    detail::active_tape = &default_tape();
+  }
+  return *detail::active_tape;
+}
+
+/**
+ * Makes a tape the active tape of this thread until the scope exits.
+ */
+struct tape_scope {
+  tape* prev_;
+  explicit tape_scope(tape& t) : prev_(detail::active_tape) {
+    detail::active_tape = &t;
+  }
+  tape_scope(const tape_scope&) = delete;
+  tape_scope& operator=(const tape_scope&) = delete;
+  ~tape_scope() { detail::active_tape = prev_; }
+};
+
+}  // namespace ad
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef AD_EX_TAPE_STATS_HPP
+#define AD_EX_TAPE_STATS_HPP
+
+#include <ad_ex/tape.hpp>
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ad {
+
+/**
+ * What a tape holds right now and what it needed at most, for sizing
+ * production tapes.
+ */
+struct tape_stats {
+  /**
+   * Records of one node type.
+   */
+  struct node_type {
+    std::string name_;
+    std::size_t count_{0};
+    std::size_t bytes_{0};
+  };
+  /**
+   * Number of nodes on the record stream.
+   */
+  std::size_t nodes_{0};
+  /**
+   * Bytes of the record stream in use, footers and padding included.
+   */
+  std::size_t record_bytes_{0};
+  std::size_t record_peak_bytes_{0};
+  /**
+   * Bytes of the arena in use, for leaves and matrix storage.
+   */
+  std::size_t arena_bytes_{0};
+  std::size_t arena_peak_bytes_{0};
+  /**
+   * Chunks the arena and the record stream took from the system allocator.
+   */
+  std::size_t upstream_allocations_{0};
+  /**
+   * Nodes by type, largest total size first.
+   */
+  std::vector<node_type> node_types_;
+};
+
+namespace detail {
+/**
+ * Turn the compiler's name of a node type into a short label. A
+ * `lambda_var_base` is named after the function its lambda was written in,
+ * with the value type in brackets when it is not a double, e.g. `log` or
+ * `exp[Matrix]`. Other nodes keep their template name.
+ */
+inline std::string node_label(std::string_view name) {
+  std::string s;
+  for (std::size_t i = 0; i < name.size();) {
+    if (name.substr(i, 4) == "ad::") {
+      i += 4;
+    } else if (name.substr(i, 7) == "Eigen::") {
+      i += 7;
+    } else {
+      s += name[i++];
+    }
+  }
+  const std::string node = s.substr(0, s.find('<'));
+  // Name of the function a lambda is declared in: GCC writes
+  // `f(args)::<lambda(...)>`, clang `(lambda at file:line:col)`.
+  std::string op;
+  if (auto p = s.find("::<lambda"); p != std::string::npos) {
+    std::size_t i = p;
+    int depth = 0;
+    while (i > 0) {
+      const char c = s[i - 1];
+      if (c == ')' || c == '>') {
+        ++depth;
+      } else if ((c == '(' || c == '<') && depth > 0) {
+        --depth;
+      } else if (depth == 0 && (c == ' ' || c == ',' || c == '<')) {
+        break;
+      }
+      --i;
+    }
+    op = s.substr(i, p - i);
+    op = op.substr(0, std::min(op.find('('), op.find('<')));
+  } else if (auto p = s.find("(lambda at "); p != std::string::npos) {
+    const auto end = s.find(')', p);
+    std::string where = s.substr(p + 11, end - p - 11);
+    where = where.substr(where.find_last_of('/') + 1);
+    op = where.substr(0, where.rfind(':'));
+  }
+  if (op.empty()) {
+    return node;
+  }
+  if (node == "lambda_var_base") {
+    const auto first = s.find('<') + 1;
+    std::string value_t = s.substr(first, s.find_first_of(",<", first) - first);
+    if (value_t.starts_with("const ")) {
+      value_t = value_t.substr(6);
+    }
+    return value_t == "double" ? op : op + "[" + value_t + "]";
+  }
+  return node + ":" + op;
+}
+}  // namespace detail
+
+/**
+ * Collect the statistics of tape `t`. Walks the record stream once.
+ */
+inline tape_stats get_stats(const tape& t) {
+  tape_stats stats;
+  std::unordered_map<record_stack::chain_fn, tape_stats::node_type> by_type;
+  t.records_.for_each_record([&](record_stack::chain_fn chain, std::size_t bytes) {
+    auto& type = by_type[chain];
+    ++type.count_;
+    type.bytes_ += bytes;
+    ++stats.nodes_;
+    stats.record_bytes_ += bytes;
+  });
+  stats.record_peak_bytes_ = t.records_.memory().peak_bytes();
+  stats.arena_bytes_ = t.mbr_.bytes_used();
+  stats.arena_peak_bytes_ = t.mbr_.peak_bytes();
+  stats.upstream_allocations_ = t.mbr_.upstream_allocations()
+                                + t.records_.memory().upstream_allocations();
+  // Types with the same label, e.g. one operator used with different
+  // argument types, are merged.
+  std::unordered_map<std::string, tape_stats::node_type> by_label;
+  for (auto&& [chain, type] : by_type) {
+    auto label = detail::node_label(record_stack::node_name(chain));
+    auto& merged = by_label[label];
+    merged.name_ = label;
+    merged.count_ += type.count_;
+    merged.bytes_ += type.bytes_;
+  }
+  for (auto&& [label, type] : by_label) {
+    stats.node_types_.push_back(std::move(type));
+  }
+  std::sort(stats.node_types_.begin(), stats.node_types_.end(),
+            [](auto&& a, auto&& b) { return a.bytes_ > b.bytes_; });
+  return stats;
+}
+
+/**
+ * Print `stats` as a table of node types followed by the totals.
+ */
+inline std::ostream& operator<<(std::ostream& os, const tape_stats& stats) {
+  os << "nodes " << stats.nodes_ << ", record bytes " << stats.record_bytes_
+     << " (peak " << stats.record_peak_bytes_ << "), arena bytes "
+     << stats.arena_bytes_ << " (peak " << stats.arena_peak_bytes_
+     << "), upstream allocations " << stats.upstream_allocations_ << "\n";
+  for (auto&& type : stats.node_types_) {
+    os << "  " << type.name_ << ": " << type.count_ << " x "
+       << type.bytes_ / type.count_ << " bytes\n";
+  }
+  return os;
+}
+
+/**
+ * Report the statistics of `t` as benchmark counters: the totals, then a
+ * count and a byte size per node type. Meant to be called after the timing
+ * loop while the tape still holds the last gradient.
+ */
+inline void report_tape_stats(benchmark::State& state, const tape& t = get_tape()) {
+  const auto stats = get_stats(t);
+  state.counters["nodes"] = stats.nodes_;
+  state.counters["record_bytes"] = stats.record_bytes_;
+  state.counters["arena_bytes"] = stats.arena_bytes_;
+  state.counters["peak_bytes"]
+      = stats.record_peak_bytes_ + stats.arena_peak_bytes_;
+  state.counters["upstream_allocs"] = stats.upstream_allocations_;
+  for (auto&& type : stats.node_types_) {
+    state.counters["n:" + type.name_] = type.count_;
+    state.counters["B:" + type.name_] = type.bytes_ / type.count_;
+  }
+}
+
+}  // namespace ad
+
+#endif
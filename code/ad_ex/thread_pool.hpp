@@ -0,0 +1,198 @@
+#ifndef AD_EX_THREAD_POOL_HPP
+#define AD_EX_THREAD_POOL_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ad {
+
+/**
+ * Fixed set of threads running index ranges with work stealing.
+ *
+ * `parallel_for(n, f)` splits `[0, n)` into one contiguous range per thread,
+ * the calling thread included. Each thread runs its own range front to back
+ * and, once it is empty, steals the back half of the range of another thread
+ * that still has work. Uneven task costs are balanced without a shared queue
+ * every task has to go through.
+ *
+ * A pool runs one `parallel_for()` at a time: calls from several threads are
+ * serialized and each waits for the one before it to finish. A
+ * `parallel_for()` called from inside one of the pool's own tasks, on a
+ * worker or on the calling thread, runs its loop inline on that thread
+ * instead, since the pool's threads are all busy with the outer call.
+ */
+class thread_pool {
+ public:
+  /**
+   * @param n_threads number of threads running tasks, including the thread
+   *  calling `parallel_for()`
+   */
+  explicit thread_pool(std::size_t n_threads
+                       = std::max(1u, std::thread::hardware_concurrency()))
+      : ranges_(std::make_unique<range[]>(std::max<std::size_t>(n_threads, 1))),
+        n_threads_(std::max<std::size_t>(n_threads, 1)) {
+    for (std::size_t i = 1; i < n_threads_; ++i) {
+      threads_.emplace_back([this, i] { worker_loop(i); });
+    }
+  }
+
+  thread_pool(const thread_pool&) = delete;
+  thread_pool& operator=(const thread_pool&) = delete;
+
+  ~thread_pool() {
+    {
+      std::lock_guard<std::mutex> lock(m_);
+      stop_ = true;
+    }
+    start_cv_.notify_all();
+    for (auto&& t : threads_) {
+      t.join();
+    }
+  }
+
+  /**
+   * @return number of threads running tasks, including the caller
+   */
+  inline std::size_t size() const noexcept { return n_threads_; }
+
+  /**
+   * Call `f(i)` for every `i` in `[0, n)` and wait for all of them. The first
+   * exception thrown by a task is rethrown here once every thread stopped.
+   * @param n number of tasks
+   * @param f task body
+   */
+  inline void parallel_for(std::size_t n, const std::function<void(std::size_t)>& f) {
+    if (current_ == this) {
+      for (std::size_t i = 0; i < n; ++i) {
+        f(i);
+      }
+      return;
+    }
+    std::lock_guard<std::mutex> call_lock(call_m_);
+    for (std::size_t i = 0; i < n_threads_; ++i) {
+      ranges_[i].begin_ = n * i / n_threads_;
+      ranges_[i].end_ = n * (i + 1) / n_threads_;
+    }
+    {
+      std::lock_guard<std::mutex> lock(m_);
+      task_ = &f;
+      error_ = nullptr;
+      active_ = threads_.size();
+      ++generation_;
+    }
+    start_cv_.notify_all();
+    const thread_pool* outer = std::exchange(current_, this);
+    work(0);
+    current_ = outer;
+    std::unique_lock<std::mutex> lock(m_);
+    done_cv_.wait(lock, [this] { return active_ == 0; });
+    task_ = nullptr;
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+  }
+
+ private:
+  struct alignas(64) range {
+    std::mutex m_;
+    std::size_t begin_{0};
+    std::size_t end_{0};
+  };
+
+  inline void worker_loop(std::size_t id) {
+    current_ = this;
+    std::size_t seen = 0;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(m_);
+        start_cv_.wait(lock, [&] { return stop_ || generation_ != seen; });
+        if (stop_) {
+          return;
+        }
+        seen = generation_;
+      }
+      work(id);
+      std::lock_guard<std::mutex> lock(m_);
+      if (--active_ == 0) {
+        done_cv_.notify_one();
+      }
+    }
+  }
+
+  /**
+   * Pop a task from the front of our own range, or refill it with the back
+   * half of another thread's range.
+   */
+  inline bool next_task(std::size_t id, std::size_t& task) {
+    range& own = ranges_[id];
+    {
+      std::lock_guard<std::mutex> lock(own.m_);
+      if (own.begin_ < own.end_) {
+        task = own.begin_++;
+        return true;
+      }
+    }
+    for (std::size_t k = 1; k < n_threads_; ++k) {
+      range& victim = ranges_[(id + k) % n_threads_];
+      std::size_t begin;
+      std::size_t end;
+      {
+        std::lock_guard<std::mutex> lock(victim.m_);
+        if (victim.begin_ >= victim.end_) {
+          continue;
+        }
+        end = victim.end_;
+        begin = end - (end - victim.begin_ + 1) / 2;
+        victim.end_ = begin;
+      }
+      std::lock_guard<std::mutex> lock(own.m_);
+      task = begin;
+      own.begin_ = begin + 1;
+      own.end_ = end;
+      return true;
+    }
+    return false;
+  }
+
+  inline void work(std::size_t id) {
+    std::size_t task;
+    while (next_task(id, task)) {
+      try {
+        (*task_)(task);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(m_);
+        if (!error_) {
+          error_ = std::current_exception();
+        }
+      }
+    }
+  }
+
+  std::unique_ptr<range[]> ranges_;
+  std::size_t n_threads_;
+  std::vector<std::thread> threads_;
+  // Held for the whole of a parallel_for(), so calls run one at a time.
+  std::mutex call_m_;
+  std::mutex m_;
+  std::condition_variable start_cv_;
+  std::condition_variable done_cv_;
+  const std::function<void(std::size_t)>* task_{nullptr};
+  std::exception_ptr error_;
+  std::size_t active_{0};
+  std::size_t generation_{0};
+  bool stop_{false};
+  // The pool whose tasks this thread is running, if any.
+  static inline thread_local const thread_pool* current_{nullptr};
+};
+
+}  // namespace ad
+
+#endif
@@ -0,0 +1,385 @@
+#ifndef AD_EX_VAR_MATRIX_HPP
+#define AD_EX_VAR_MATRIX_HPP
+
+#include <ad_ex/meta/Eigen.hpp>
+#include <ad_ex/meta/is_eigen.hpp>
+#include <ad_ex/lambda.hpp>
+#include <ad_ex/eigen_numtraits.hpp>
+#include <ad_ex/arena_matrix.hpp>
+#include <unsupported/Eigen/SpecialFunctions>
+#include <cmath>
+#include <type_traits>
+#include <utility>
+
+namespace ad {
+
+/**
+ * Eigen matrix, as opposed to an Eigen array, so lane arrays keep their own
+ * `var_base`.
+ */
+template <typename T>
+concept DenseMatrix
+    = EigenMatrix<T>
+      && std::is_base_of_v<Eigen::MatrixBase<std::decay_t<T>>, std::decay_t<T>>;
+
+/**
+ * A whole matrix as one node. Values and adjoints live in the arena, so the
+ * reverse pass of an operation is one Eigen expression over both.
+ */
+template <typename T>
+requires DenseMatrix<T>
+struct var_base<T> : public var_base_chain {
+  arena_matrix<T> value_;
+  arena_matrix<T> adjoint_;
+  /**
+   * @param x matrix or expression, evaluated straight into the arena
+   */
+  template <EigenMatrix Expr>
+  var_base(const Expr& x)
+      : var_base_chain(),
+        value_(x),
+        adjoint_(value_.rows(), value_.cols()) {
+    adjoint_.setZero();
+  }
+  inline auto& val() {
+    return value_;
+  }
+  inline auto& adj() {
+    return adjoint_;
+  }
+};
+
+namespace detail {
+template <typename T>
+struct is_var_matrix : std::false_type {};
+template <typename T>
+requires DenseMatrix<T>
+struct is_var_matrix<var_impl<T>> : std::true_type {};
+}  // namespace detail
+
+template <typename T>
+inline constexpr bool is_matrix_var = is_eigen_v<std::decay_t<T>> && is_var_v<typename std::decay_t<T>::Scalar>;
+template <typename T>
+inline constexpr bool is_var_matrix = detail::is_var_matrix<std::remove_cvref_t<T>>::value;
+template <typename T>
+concept VarMatrix = is_var_matrix<T>;
+template <typename... Types>
+concept AllVarMatrix = (VarMatrix<Types> && ...);
+
+template <typename T>
+concept MatrixVar = EigenMatrix<T> && is_var_v<typename std::decay_t<T>::Scalar>;
+template <typename... Types>
+concept AllMatrixVar = (MatrixVar<Types> && ...);
+
+template <typename T>
+concept PlainMatrix = EigenMatrix<T> && std::is_arithmetic_v<typename std::decay_t<T>::Scalar>;
+
+template <typename T>
+concept RevMatrix = MatrixVar<T> || VarMatrix<T>;
+template <PlainMatrix T>
+inline decltype(auto) value(T&& x) {
+  return x;
+}
+
+/**
+ * `make_var()` for a matrix result given as an Eigen expression. The
+ * expression is evaluated once, directly into the arena, instead of into a
+ * heap temporary that is then copied over.
+ * @tparam T plain matrix type of the result
+ */
+template <typename T, EigenMatrix Expr, typename Lambda>
+inline auto make_var_matrix(const Expr& ret_val, Lambda&& lambda) {
+  using node_t = lambda_var_base<T, std::decay_t<Lambda>>;
+  return var_impl<T>(make_inbuffer<node_t>(ret_val, std::move(lambda)));
+}
+
+namespace detail {
+/**
+ * Coefficientwise view of an operand: the array of values of a var matrix,
+ * or a double as is so Eigen broadcasts it.
+ */
+template <typename T>
+inline decltype(auto) value_array(T& x) {
+  if constexpr (VarMatrix<T>) {
+    return x.val().array();
+  } else {
+    return x;
+  }
+}
+}  // namespace detail
+
+/**
+ * Convert a `Matrix<var>` into a `var<Matrix>` with one node. The reverse
+ * pass adds each coefficient of the result's adjoint to the matching var.
+ * @param x matrix or expression of vars
+ */
+template <MatrixVar T>
+inline auto to_var_value(const T& x) {
+  using x_t = std::decay_t<T>;
+  using mat_v = Eigen::Matrix<var, x_t::RowsAtCompileTime, x_t::ColsAtCompileTime>;
+  using ret_t = Eigen::Matrix<double, x_t::RowsAtCompileTime,
+                              x_t::ColsAtCompileTime>;
+  arena_matrix<mat_v> arena_x(x);
+  return make_var_matrix<ret_t>(
+      arena_x.unaryExpr([](const var& v) { return v.val(); }),
+      [arena_x](auto&& ret) mutable {
+    for (Eigen::Index i = 0; i < arena_x.size(); ++i) {
+      arena_x.coeffRef(i).adj() += ret.adj().coeff(i);
+    }
+  });
+}
+
+/**
+ * Write a `var<Matrix>` into `dst` as one fresh var per coefficient. A
+ * single callback recorded after them sends their adjoints back to `x`.
+ */
+template <VarMatrix T, MatrixVar Dst>
+inline void from_var_value(T x, Dst& dst) {
+  using mat_d = typename T::value_type;
+  using mat_v = Eigen::Matrix<var, mat_d::RowsAtCompileTime, mat_d::ColsAtCompileTime>;
+  const auto& x_val = x.val();
+  arena_matrix<mat_v> arena_dst(x_val.rows(), x_val.cols());
+  for (Eigen::Index i = 0; i < x_val.size(); ++i) {
+    arena_dst.coeffRef(i) = var(x_val.coeff(i));
+  }
+  dst = arena_dst;
+  reverse_pass_callback([x, arena_dst]() mutable {
+    for (Eigen::Index i = 0; i < arena_dst.size(); ++i) {
+      x.adj().coeffRef(i) += arena_dst.coeffRef(i).adj();
+    }
+  });
+}
+
+/**
+ * Convert a `var<Matrix>` into a `Matrix<var>`, see the two argument
+ * overload.
+ */
+template <VarMatrix T>
+inline auto from_var_value(T x) {
+  using mat_d = typename T::value_type;
+  Eigen::Matrix<var, mat_d::RowsAtCompileTime, mat_d::ColsAtCompileTime> ret;
+  from_var_value(x, ret);
+  return ret;
+}
+
+/**
+ * A var matrix with a double or with another var matrix of the same type.
+ */
+template <typename A, typename B>
+concept var_matrix_operands
+    = (VarMatrix<A> && VarMatrix<B>
+       && std::is_same_v<std::remove_cvref_t<A>, std::remove_cvref_t<B>>)
+      || (VarMatrix<A> && Arithmetic<B>) || (Arithmetic<A> && VarMatrix<B>);
+
+template <typename T1, typename T2>
+using var_matrix_value_t =
+    typename std::remove_cvref_t<std::conditional_t<VarMatrix<T1>, T1, T2>>::value_type;
+
+template <typename T1, typename T2>
+requires AllVarMatrix<T1, T2>
+inline auto multiply(T1&& lhs, T2&& rhs) {
+  return make_var((value(lhs) * value(rhs)).eval(), [lhs, rhs](auto&& ret) mutable {
+      lhs.adj().noalias() += ret.adj() * rhs.val().transpose();
+      rhs.adj().noalias() += lhs.val().transpose() * ret.adj();
+  });
+}
+/**
+ * Product of a dense matrix of doubles and a var matrix. The data is copied
+ * into the arena once and only `rhs` gets an adjoint, `lhs^T * ret.adj()`.
+ */
+template <typename T1, VarMatrix T2>
+requires PlainMatrix<T1> && DenseMatrix<T1>
+inline auto multiply(const T1& lhs, T2 rhs) {
+  using lhs_t = typename std::decay_t<T1>::PlainObject;
+  using ret_t = Eigen::Matrix<double, Eigen::Dynamic,
+                              std::decay_t<T2>::value_type::ColsAtCompileTime>;
+  arena_matrix<lhs_t> arena_lhs(lhs);
+  return make_var_matrix<ret_t>(arena_lhs * rhs.val(),
+                                [arena_lhs, rhs](auto&& ret) mutable {
+    rhs.adj().noalias() += arena_lhs.transpose() * ret.adj();
+  });
+}
+template <VarMatrix T>
+inline auto sum(T&& x) {
+  return make_var(x.val().sum(), [x](auto&& ret) mutable {
+    x.adj().array() += ret.adj();
+  });
+}
+
+template <typename T1, typename T2>
+requires var_matrix_operands<T1, T2>
+inline auto operator+(T1 lhs, T2 rhs) {
+  using ret_t = var_matrix_value_t<T1, T2>;
+  return make_var_matrix<ret_t>(
+      detail::value_array(lhs) + detail::value_array(rhs),
+      [lhs, rhs](auto&& ret) mutable {
+    if constexpr (VarMatrix<T1>) {
+      lhs.adj() += ret.adj();
+    }
+    if constexpr (VarMatrix<T2>) {
+      rhs.adj() += ret.adj();
+    }
+  });
+}
+template <typename T1, typename T2>
+requires var_matrix_operands<T1, T2>
+inline auto operator-(T1 lhs, T2 rhs) {
+  using ret_t = var_matrix_value_t<T1, T2>;
+  return make_var_matrix<ret_t>(
+      detail::value_array(lhs) - detail::value_array(rhs),
+      [lhs, rhs](auto&& ret) mutable {
+    if constexpr (VarMatrix<T1>) {
+      lhs.adj() += ret.adj();
+    }
+    if constexpr (VarMatrix<T2>) {
+      rhs.adj() -= ret.adj();
+    }
+  });
+}
+/**
+ * Coefficientwise (Hadamard) product.
+ */
+template <typename T1, typename T2>
+requires var_matrix_operands<T1, T2>
+inline auto elt_multiply(T1 lhs, T2 rhs) {
+  using ret_t = var_matrix_value_t<T1, T2>;
+  return make_var_matrix<ret_t>(
+      detail::value_array(lhs) * detail::value_array(rhs),
+      [lhs, rhs](auto&& ret) mutable {
+    if constexpr (VarMatrix<T1>) {
+      lhs.adj().array() += ret.adj().array() * detail::value_array(rhs);
+    }
+    if constexpr (VarMatrix<T2>) {
+      rhs.adj().array() += ret.adj().array() * detail::value_array(lhs);
+    }
+  });
+}
+/**
+ * Coefficientwise quotient.
+ */
+template <typename T1, typename T2>
+requires var_matrix_operands<T1, T2>
+inline auto elt_divide(T1 lhs, T2 rhs) {
+  using ret_t = var_matrix_value_t<T1, T2>;
+  return make_var_matrix<ret_t>(
+      detail::value_array(lhs) / detail::value_array(rhs),
+      [lhs, rhs](auto&& ret) mutable {
+    if constexpr (VarMatrix<T1>) {
+      lhs.adj().array() += ret.adj().array() / detail::value_array(rhs);
+    }
+    if constexpr (VarMatrix<T2>) {
+      rhs.adj().array()
+          -= ret.adj().array() * ret.val().array() / detail::value_array(rhs);
+    }
+  });
+}
+template <VarMatrix T>
+inline auto operator-(T x) {
+  using ret_t = typename T::value_type;
+  return make_var_matrix<ret_t>(-x.val(), [x](auto&& ret) mutable {
+    x.adj() -= ret.adj();
+  });
+}
+template <VarMatrix T>
+inline auto exp(T x) {
+  using ret_t = typename T::value_type;
+  return make_var_matrix<ret_t>(x.val().array().exp(), [x](auto&& ret) mutable {
+    x.adj().array() += ret.adj().array() * ret.val().array();
+  });
+}
+template <VarMatrix T>
+inline auto log(T x) {
+  using ret_t = typename T::value_type;
+  return make_var_matrix<ret_t>(x.val().array().log(), [x](auto&& ret) mutable {
+    x.adj().array() += ret.adj().array() / x.val().array();
+  });
+}
+template <VarMatrix T>
+inline auto log1p(T x) {
+  using ret_t = typename T::value_type;
+  return make_var_matrix<ret_t>(x.val().array().log1p(), [x](auto&& ret) mutable {
+    x.adj().array() += ret.adj().array() / (1.0 + x.val().array());
+  });
+}
+template <VarMatrix T>
+inline auto sqrt(T x) {
+  using ret_t = typename T::value_type;
+  return make_var_matrix<ret_t>(x.val().array().sqrt(), [x](auto&& ret) mutable {
+    x.adj().array() += 0.5 * ret.adj().array() / ret.val().array();
+  });
+}
+/**
+ * Coefficientwise power. Either side may be a double, broadcast over the
+ * other.
+ */
+template <typename T1, typename T2>
+requires var_matrix_operands<T1, T2>
+inline auto pow(T1 base, T2 exponent) {
+  using ret_t = var_matrix_value_t<T1, T2>;
+  auto&& b = detail::value_array(base);
+  auto&& e = detail::value_array(exponent);
+  auto ret_val = [&] {
+    if constexpr (VarMatrix<T1>) {
+      return b.pow(e);
+    } else {
+      return Eigen::pow(b, e);
+    }
+  }();
+  return make_var_matrix<ret_t>(ret_val, [base, exponent](auto&& ret) mutable {
+    auto&& b = detail::value_array(base);
+    auto&& e = detail::value_array(exponent);
+    if constexpr (VarMatrix<T1>) {
+      base.adj().array() += ret.adj().array() * e * b.pow(e - 1.0);
+    }
+    if constexpr (VarMatrix<T2>) {
+      if constexpr (VarMatrix<T1>) {
+        exponent.adj().array() += ret.adj().array() * ret.val().array() * b.log();
+      } else {
+        exponent.adj().array() += ret.adj().array() * ret.val().array() * std::log(b);
+      }
+    }
+  });
+}
+template <VarMatrix T>
+inline auto lgamma(T x) {
+  using ret_t = typename T::value_type;
+  return make_var_matrix<ret_t>(x.val().array().lgamma(), [x](auto&& ret) mutable {
+    x.adj().array() += ret.adj().array() * x.val().array().digamma();
+  });
+}
+/**
+ * Logistic function `1 / (1 + exp(-x))`, see the scalar `inv_logit()`.
+ */
+template <VarMatrix T>
+inline auto inv_logit(T x) {
+  using ret_t = typename T::value_type;
+  return make_var_matrix<ret_t>(x.val().array().logistic(), [x](auto&& ret) mutable {
+    x.adj().array()
+        += ret.adj().array() * ret.val().array() * (1.0 - ret.val().array());
+  });
+}
+/**
+ * `log(1 + exp(x))`, see the scalar `softplus()`.
+ */
+template <VarMatrix T>
+inline auto softplus(T x) {
+  using ret_t = typename T::value_type;
+  return make_var_matrix<ret_t>(
+      x.val().array().max(0.0) + (-x.val().array().abs()).exp().log1p(),
+      [x](auto&& ret) mutable {
+    x.adj().array() += ret.adj().array() * x.val().array().logistic();
+  });
+}
+
+/**
+ * Scalar `lgamma()`, here rather than next to the other scalar functions
+ * because its derivative comes from Eigen's digamma.
+ */
+inline auto lgamma(var x) {
+    return make_var(std::lgamma(x.val()), [x](auto&& ret) mutable {
+      x.adj() += ret.adj() * Eigen::numext::digamma(x.val());
+    });
+}
+
+}  // namespace ad
+#endif
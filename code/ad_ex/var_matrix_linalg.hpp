@@ -0,0 +1,259 @@
+#ifndef AD_EX_VAR_MATRIX_LINALG_HPP
+#define AD_EX_VAR_MATRIX_LINALG_HPP
+
+#include <ad_ex/meta/Eigen.hpp>
+#include <ad_ex/lambda.hpp>
+#include <ad_ex/arena_matrix.hpp>
+#include <ad_ex/var_matrix.hpp>
+#include <stdexcept>
+#include <type_traits>
+
+/**
+ * Factorizations and solves on `var<Matrix>`. Each is one node: the forward
+ * pass factors the double matrix once, keeps what the reverse pass needs in
+ * the arena, and the reverse pass is a handful of triangular solves and
+ * products on it, which Eigen runs blocked. The same code on `Matrix<var>`
+ * records a scalar node for each of the O(N^3) flops of the factorization.
+ */
+namespace ad {
+
+/**
+ * Dense matrix of doubles or a var matrix, with at least one var matrix.
+ */
+template <typename A, typename B>
+concept var_linalg_operands
+    = (VarMatrix<A> || VarMatrix<B>)
+      && (VarMatrix<A> || (PlainMatrix<A> && DenseMatrix<A>))
+      && (VarMatrix<B> || (PlainMatrix<B> && DenseMatrix<B>));
+
+namespace detail {
+/**
+ * Plain matrix type of the values of `T`.
+ */
+template <typename T>
+struct plain_value_type {
+  using type = typename std::decay_t<T>::PlainObject;
+};
+template <VarMatrix T>
+struct plain_value_type<T> {
+  using type = typename std::decay_t<T>::value_type;
+};
+template <typename T>
+using plain_value_t = typename plain_value_type<T>::type;
+
+template <typename T>
+inline const auto& value_of(const T& x) {
+  if constexpr (VarMatrix<T>) {
+    return x.val();
+  } else {
+    return x;
+  }
+}
+
+/**
+ * A var matrix as is, or data copied into the arena so a reverse pass can
+ * read it.
+ */
+template <typename T>
+inline auto to_arena(const T& x) {
+  if constexpr (VarMatrix<T>) {
+    return x;
+  } else {
+    return arena_matrix<plain_value_t<T>>(x);
+  }
+}
+
+/**
+ * Stand in for an operand that is data and whose value is not needed in the
+ * reverse pass, so nothing of it is captured.
+ */
+struct no_adjoint {};
+
+/**
+ * A var matrix as is, or `no_adjoint` for data.
+ */
+template <typename T>
+inline auto reverse_operand(const T& x) {
+  if constexpr (VarMatrix<T>) {
+    return x;
+  } else {
+    return no_adjoint{};
+  }
+}
+
+/**
+ * LU factorization with partial pivoting, `P A = L U`, with the factors and
+ * the permutation copied into the arena so the reverse pass solves with them
+ * again instead of refactoring.
+ */
+struct arena_lu {
+  using permutation_t = Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int>;
+  arena_matrix<Eigen::MatrixXd> lu_;
+  Eigen::Map<permutation_t> perm_;
+
+  explicit arena_lu(const Eigen::PartialPivLU<Eigen::MatrixXd>& lu)
+      : lu_(lu.matrixLU()), perm_(copy_indices(lu.permutationP())) {}
+
+  arena_lu(const arena_lu& other)
+      : lu_(other.lu_),
+        perm_(other.perm_.indices().data(), other.perm_.size()) {}
+
+  /**
+   * @return `log(abs(det(A)))`
+   */
+  inline double log_abs_det() const {
+    return lu_.diagonal().array().abs().log().sum();
+  }
+
+  /**
+   * @return `A^-T x`
+   */
+  template <typename T>
+  inline auto transpose_solve(const T& x) const {
+    using ret_t = Eigen::Matrix<double, Eigen::Dynamic, T::ColsAtCompileTime>;
+    ret_t z = lu_.template triangularView<Eigen::Upper>().transpose().solve(x);
+    lu_.template triangularView<Eigen::UnitLower>().transpose().solveInPlace(z);
+    return ret_t(perm_.transpose() * z);
+  }
+
+ private:
+  static inline Eigen::Map<permutation_t> copy_indices(const permutation_t& p) {
+    arena_matrix<Eigen::VectorXi> indices(p.indices());
+    return Eigen::Map<permutation_t>(indices.data(), indices.size());
+  }
+};
+}  // namespace detail
+
+/**
+ * Lower Cholesky factor `L` of a symmetric positive definite matrix, `A = L
+ * L^T`. The factor is the result's value, so the reverse pass reads it from
+ * there.
+ *
+ * The reverse pass is Murray's (2016) matrix form,
+ * `A.adj += sym(L^-T Phi(L^T L.adj) L^-1) / 2` where `Phi()` takes the lower
+ * triangle and halves the diagonal. Only the lower triangle of `A` is read in
+ * the forward pass but the adjoint is spread symmetrically over both.
+ * @throw std::domain_error if `A` is not positive definite
+ */
+template <VarMatrix T>
+inline auto cholesky_decompose(T A) {
+  using ret_t = typename T::value_type;
+  Eigen::LLT<ret_t> llt(A.val());
+  if (llt.info() != Eigen::Success) {
+    throw std::domain_error("cholesky_decompose: matrix is not positive definite");
+  }
+  return make_var_matrix<ret_t>(llt.matrixL(), [A](auto&& ret) mutable {
+    const auto& L = ret.val();
+    ret_t P = L.transpose() * ret.adj().template triangularView<Eigen::Lower>();
+    P.template triangularView<Eigen::StrictlyUpper>().setZero();
+    P.diagonal() *= 0.5;
+    L.template triangularView<Eigen::Lower>().transpose().solveInPlace(P);
+    L.template triangularView<Eigen::Lower>()
+        .template solveInPlace<Eigen::OnTheRight>(P);
+    A.adj() += 0.5 * (P + P.transpose());
+  });
+}
+
+/**
+ * `A^-1 B` for a triangular `A`, by substitution. Only the `Mode` triangle of
+ * `A` is read and gets adjoints.
+ * @tparam Mode `Eigen::Lower` or `Eigen::Upper`
+ */
+template <int Mode = Eigen::Lower, typename T1, typename T2>
+requires var_linalg_operands<T1, T2>
+inline auto mdivide_left_tri(const T1& A, const T2& B) {
+  using ret_t = Eigen::Matrix<double, Eigen::Dynamic,
+                              detail::plain_value_t<T2>::ColsAtCompileTime>;
+  auto arena_A = detail::to_arena(A);
+  return make_var_matrix<ret_t>(
+      detail::value_of(arena_A).template triangularView<Mode>().solve(
+          detail::value_of(B)),
+      [arena_A, B_rev = detail::reverse_operand(B)](auto&& ret) mutable {
+    ret_t adj_B = detail::value_of(arena_A)
+                      .template triangularView<Mode>()
+                      .transpose()
+                      .solve(ret.adj());
+    if constexpr (VarMatrix<T1>) {
+      arena_A.adj().template triangularView<Mode>()
+          -= adj_B * ret.val().transpose();
+    }
+    if constexpr (VarMatrix<T2>) {
+      B_rev.adj() += adj_B;
+    }
+  });
+}
+
+/**
+ * `A^-1 B` for a square `A`. The LU factors of `A` are kept in the arena for
+ * the reverse pass, `B.adj += A^-T ret.adj` and `A.adj -= A^-T ret.adj
+ * ret^T`.
+ */
+template <typename T1, typename T2>
+requires var_linalg_operands<T1, T2>
+inline auto mdivide_left(const T1& A, const T2& B) {
+  using ret_t = Eigen::Matrix<double, Eigen::Dynamic,
+                              detail::plain_value_t<T2>::ColsAtCompileTime>;
+  Eigen::PartialPivLU<Eigen::MatrixXd> lu(detail::value_of(A));
+  return make_var_matrix<ret_t>(
+      lu.solve(detail::value_of(B)),
+      [lu_A = detail::arena_lu(lu), A_rev = detail::reverse_operand(A),
+       B_rev = detail::reverse_operand(B)](auto&& ret) mutable {
+    ret_t adj_B = lu_A.transpose_solve(ret.adj());
+    if constexpr (VarMatrix<T1>) {
+      A_rev.adj().noalias() -= adj_B * ret.val().transpose();
+    }
+    if constexpr (VarMatrix<T2>) {
+      B_rev.adj() += adj_B;
+    }
+  });
+}
+
+/**
+ * `log(abs(det(A)))` for a square `A`, from its LU factors, which the reverse
+ * pass reuses for `A.adj += ret.adj A^-T`.
+ */
+template <VarMatrix T>
+inline auto log_determinant(T A) {
+  Eigen::PartialPivLU<Eigen::MatrixXd> lu(A.val());
+  detail::arena_lu lu_A(lu);
+  return make_var(lu_A.log_abs_det(), [A, lu_A](auto&& ret) mutable {
+    const auto N = A.val().rows();
+    A.adj() += ret.adj() * lu_A.transpose_solve(Eigen::MatrixXd::Identity(N, N));
+  });
+}
+
+/**
+ * `log(det(A))` for a symmetric positive definite `A`, from its Cholesky
+ * factor, which the reverse pass reuses for `A.adj += ret.adj A^-1`.
+ * @throw std::domain_error if `A` is not positive definite
+ */
+template <VarMatrix T>
+inline auto log_determinant_spd(T A) {
+  using mat_t = typename T::value_type;
+  Eigen::LLT<mat_t> llt(A.val());
+  if (llt.info() != Eigen::Success) {
+    throw std::domain_error("log_determinant_spd: matrix is not positive definite");
+  }
+  arena_matrix<mat_t> L(llt.matrixL());
+  return make_var(2.0 * L.diagonal().array().log().sum(), [A, L](auto&& ret) mutable {
+    mat_t L_inv = mat_t::Identity(L.rows(), L.cols());
+    L.template triangularView<Eigen::Lower>().solveInPlace(L_inv);
+    A.adj().noalias() += ret.adj() * L_inv.transpose() * L_inv;
+  });
+}
+
+/**
+ * `A^-1`, whose value is all the reverse pass needs:
+ * `A.adj -= ret^T ret.adj ret^T`.
+ */
+template <VarMatrix T>
+inline auto inverse(T A) {
+  using ret_t = typename T::value_type;
+  return make_var_matrix<ret_t>(A.val().inverse(), [A](auto&& ret) mutable {
+    A.adj().noalias()
+        -= ret.val().transpose() * ret.adj() * ret.val().transpose();
+  });
+}
+
+}  // namespace ad
+#endif
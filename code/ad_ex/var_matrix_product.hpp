@@ -0,0 +1,116 @@
+#ifndef AD_EX_VAR_MATRIX_PRODUCT_HPP
+#define AD_EX_VAR_MATRIX_PRODUCT_HPP
+
+#include <ad_ex/meta/Eigen.hpp>
+#include <ad_ex/lambda.hpp>
+#include <ad_ex/var_matrix.hpp>
+
+/**
+ * Products of `Matrix<var>` whose `rows + cols + depth` is below this stay
+ * coefficient based. Above it the conversions to and from `var<Matrix>` cost
+ * less than the one node per multiply-add of the scalar product.
+ */
+#ifndef AD_VAR_MATRIX_PRODUCT_THRESHOLD
+#define AD_VAR_MATRIX_PRODUCT_THRESHOLD EIGEN_GEMM_TO_COEFFBASED_THRESHOLD
+#endif
+
+namespace ad {
+
+template <typename Lhs, typename Rhs>
+concept var_product_operands
+    = is_var_v<typename Lhs::Scalar> && is_var_v<typename Rhs::Scalar>;
+
+namespace detail {
+/**
+ * Eigen's product kernels for `Matrix<var>` operands.
+ *
+ * Large products are promoted: both operands are converted to `var<Matrix>`
+ * with one node each, multiplied with one node running double precision
+ * GEMMs in both passes, and the result is written back as vars tied to it
+ * with a single callback. Code written against `Matrix<var>` gets the
+ * `var<Matrix>` product without changes, and only O(N^2) scalar vars are
+ * made instead of O(N^3).
+ */
+template <typename Lhs, typename Rhs>
+struct var_matrix_product {
+  using lazyproduct = Eigen::internal::generic_product_impl<
+      Lhs, Rhs, Eigen::DenseShape, Eigen::DenseShape,
+      Eigen::CoeffBasedProductMode>;
+
+  static inline bool promote(const Lhs& lhs, const Rhs& rhs) {
+    return lhs.rows() + rhs.rows() + rhs.cols()
+               >= AD_VAR_MATRIX_PRODUCT_THRESHOLD
+           && rhs.rows() > 0;
+  }
+
+  /**
+   * Product of the promoted operands as a plain `Matrix<var>`.
+   */
+  static inline auto promoted(const Lhs& lhs, const Rhs& rhs) {
+    using ret_t = Eigen::Matrix<var, Lhs::RowsAtCompileTime,
+                                Rhs::ColsAtCompileTime>;
+    ret_t ret;
+    from_var_value(multiply(to_var_value(lhs), to_var_value(rhs)), ret);
+    return ret;
+  }
+
+  template <typename Dst>
+  static inline void evalTo(Dst& dst, const Lhs& lhs, const Rhs& rhs) {
+    if (promote(lhs, rhs)) {
+      from_var_value(multiply(to_var_value(lhs), to_var_value(rhs)), dst);
+    } else {
+      lazyproduct::eval_dynamic(dst, lhs, rhs,
+                                Eigen::internal::assign_op<var, var>());
+    }
+  }
+
+  template <typename Dst>
+  static inline void addTo(Dst& dst, const Lhs& lhs, const Rhs& rhs) {
+    if (promote(lhs, rhs)) {
+      dst += promoted(lhs, rhs);
+    } else {
+      lazyproduct::eval_dynamic(dst, lhs, rhs,
+                                Eigen::internal::add_assign_op<var, var>());
+    }
+  }
+
+  template <typename Dst>
+  static inline void subTo(Dst& dst, const Lhs& lhs, const Rhs& rhs) {
+    if (promote(lhs, rhs)) {
+      dst -= promoted(lhs, rhs);
+    } else {
+      lazyproduct::eval_dynamic(dst, lhs, rhs,
+                                Eigen::internal::sub_assign_op<var, var>());
+    }
+  }
+
+  template <typename Dst>
+  static inline void scaleAndAddTo(Dst& dst, const Lhs& lhs, const Rhs& rhs,
+                                   const var& alpha) {
+    if (promote(lhs, rhs)) {
+      dst += alpha * promoted(lhs, rhs);
+    } else {
+      dst += alpha * lhs.lazyProduct(rhs);
+    }
+  }
+};
+}  // namespace detail
+}  // namespace ad
+
+namespace Eigen {
+namespace internal {
+
+template <typename Lhs, typename Rhs>
+requires ad::var_product_operands<Lhs, Rhs>
+struct generic_product_impl<Lhs, Rhs, DenseShape, DenseShape, GemmProduct>
+    : ad::detail::var_matrix_product<Lhs, Rhs> {};
+
+template <typename Lhs, typename Rhs>
+requires ad::var_product_operands<Lhs, Rhs>
+struct generic_product_impl<Lhs, Rhs, DenseShape, DenseShape, GemvProduct>
+    : ad::detail::var_matrix_product<Lhs, Rhs> {};
+
+}  // namespace internal
+}  // namespace Eigen
+
+#endif
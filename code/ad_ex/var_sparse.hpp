@@ -0,0 +1,127 @@
+#ifndef AD_EX_VAR_SPARSE_HPP
+#define AD_EX_VAR_SPARSE_HPP
+
+#include <ad_ex/meta/Eigen.hpp>
+#include <ad_ex/lambda.hpp>
+#include <ad_ex/arena_matrix.hpp>
+#include <ad_ex/arena_sparse_matrix.hpp>
+#include <ad_ex/var_matrix.hpp>
+#include <type_traits>
+
+namespace ad {
+
+/**
+ * A sparse matrix as one node. Only the stored nonzeros are parameters, the
+ * adjoint shares the index arrays of the value so it holds one double per
+ * nonzero and the reverse pass never touches a structural zero.
+ */
+template <typename T>
+requires SparseMatrixType<T>
+struct var_base<T> : public var_base_chain {
+  arena_sparse_matrix<T> value_;
+  arena_sparse_matrix<T> adjoint_;
+  /**
+   * @param x sparse matrix or expression, copied compressed into the arena
+   */
+  template <SparseMatrixType Expr>
+  var_base(const Expr& x)
+      : var_base_chain(),
+        value_(x),
+        adjoint_(arena_sparse_matrix<T>::zeros_like(value_)) {}
+  inline auto& val() {
+    return value_;
+  }
+  inline auto& adj() {
+    return adjoint_;
+  }
+};
+
+namespace detail {
+template <typename T>
+struct is_var_sparse_matrix : std::false_type {};
+template <typename T>
+requires SparseMatrixType<T>
+struct is_var_sparse_matrix<var_impl<T>> : std::true_type {};
+}  // namespace detail
+
+template <typename T>
+concept VarSparseMatrix = detail::is_var_sparse_matrix<std::remove_cvref_t<T>>::value;
+
+/**
+ * Sparse matrix of doubles, data rather than a parameter.
+ */
+template <typename T>
+concept PlainSparseMatrix
+    = SparseMatrixType<T> && std::is_arithmetic_v<typename std::decay_t<T>::Scalar>;
+
+/**
+ * Product of sparse data and a var matrix. The data is copied into the arena
+ * once and the reverse pass is the sparse product `lhs^T * ret.adj()`, so it
+ * only reads the stored nonzeros of `lhs`.
+ */
+template <PlainSparseMatrix T1, VarMatrix T2>
+inline auto multiply(const T1& lhs, T2 rhs) {
+  using sparse_t = typename std::decay_t<T1>::PlainObject;
+  using ret_t = Eigen::Matrix<double, Eigen::Dynamic,
+                              std::decay_t<T2>::value_type::ColsAtCompileTime>;
+  arena_sparse_matrix<sparse_t> arena_lhs(lhs);
+  return make_var_matrix<ret_t>(arena_lhs * rhs.val(),
+                                [arena_lhs, rhs](auto&& ret) mutable {
+    rhs.adj().noalias() += arena_lhs.transpose() * ret.adj();
+  });
+}
+
+namespace detail {
+/**
+ * `adj += ret_adj * rhs^T` at the stored nonzeros of `adj` only: entry
+ * `(i, j)` gets row `i` of `ret_adj` dotted with row `j` of `rhs`.
+ */
+template <typename Sparse, typename RetAdj, typename Rhs>
+inline void add_at_nonzeros(Sparse& adj, const RetAdj& ret_adj, const Rhs& rhs) {
+  for (Eigen::Index k = 0; k < adj.outerSize(); ++k) {
+    for (typename Sparse::InnerIterator it(adj, k); it; ++it) {
+      it.valueRef() += ret_adj.row(it.row()).dot(rhs.row(it.col()));
+    }
+  }
+}
+}  // namespace detail
+
+/**
+ * Product of a sparse var and a dense matrix of doubles or var matrix. The
+ * adjoint of `lhs` is only accumulated at its stored nonzeros rather than
+ * forming the dense `ret.adj() * rhs^T`.
+ */
+template <VarSparseMatrix T1, typename T2>
+requires VarMatrix<T2> || (PlainMatrix<T2> && DenseMatrix<T2>)
+inline auto multiply(T1 lhs, const T2& rhs) {
+  if constexpr (VarMatrix<T2>) {
+    using ret_t = Eigen::Matrix<double, Eigen::Dynamic,
+                                std::decay_t<T2>::value_type::ColsAtCompileTime>;
+    return make_var_matrix<ret_t>(lhs.val() * rhs.val(),
+                                  [lhs, rhs_var = rhs](auto&& ret) mutable {
+      detail::add_at_nonzeros(lhs.adj(), ret.adj(), rhs_var.val());
+      rhs_var.adj().noalias() += lhs.val().transpose() * ret.adj();
+    });
+  } else {
+    using rhs_t = typename std::decay_t<T2>::PlainObject;
+    using ret_t = Eigen::Matrix<double, Eigen::Dynamic, rhs_t::ColsAtCompileTime>;
+    arena_matrix<rhs_t> arena_rhs(rhs);
+    return make_var_matrix<ret_t>(lhs.val() * arena_rhs,
+                                  [lhs, arena_rhs](auto&& ret) mutable {
+      detail::add_at_nonzeros(lhs.adj(), ret.adj(), arena_rhs);
+    });
+  }
+}
+
+/**
+ * Sum of the stored nonzeros.
+ */
+template <VarSparseMatrix T>
+inline auto sum(T x) {
+  return make_var(x.val().sum(), [x](auto&& ret) mutable {
+    x.adj().coeffs() += ret.adj();
+  });
+}
+
+}  // namespace ad
+#endif
@@ -1,13 +1,35 @@
 #include <ad_ex/meta/is_eigen.hpp>
 #include <benchmark/benchmark.h>
 #include <Eigen/Dense>
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <set>
 #include <utility>
 #include <vector>
 #define STRONG_INLINE __attribute__((always_inline, hot)) inline
 
+// ------------------------ Allocation counter ------------------------
+// Every heap allocation of the process goes through malloc, so counting
+// there also sees Eigen's temporaries and GEMM buffers. glibc lets the
+// executable interpose malloc and still reach the real one. Sanitizers
+// replace malloc themselves, so the counter stays at zero under them.
+static std::atomic<std::size_t> heap_allocations{0};
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+extern "C" void* __libc_malloc(std::size_t size);
+extern "C" void* malloc(std::size_t size) {
+  heap_allocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_malloc(size);
+}
+#endif
+
 namespace ad{
   template <typename T>
 struct deduce_ownership {
@@ -45,6 +67,23 @@ struct Var;
 template <typename T>
 struct VarView;
 
+// Anything that takes part in buffer planning is a node of the graph.
+template <typename T>
+concept ExprNode = requires(const std::decay_t<T>& x) {
+  { x.CacheBindSize() };
+};
+
+// Seeds arriving at b_eval are either a scalar (from Sum) or an Eigen
+// expression. Give both an array view of the node's shape.
+template <typename S>
+STRONG_INLINE auto seed_array(S&& seed, Eigen::Index rows, Eigen::Index cols) {
+  if constexpr (std::is_arithmetic_v<std::decay_t<S>>) {
+    return Eigen::ArrayXXd::Constant(rows, cols, seed);
+  } else {
+    return seed.array();
+  }
+}
+
 template <typename T>
 requires EigenMatrix<T>
 struct VarView<T> {
@@ -54,44 +93,195 @@ struct VarView<T> {
   Eigen::Map<T> vals_;
   Eigen::Map<T> adjs_;
 };
+// --------------------------- BufferPlan -----------------------------
+// Liveness based layout of the value and adjoint buffers.
+//
+// PlanForward/PlanReverse walk the graph in the same order f_eval/b_eval
+// do, ticking a clock at every node. Each value or adjoint slab is a block
+// live from the tick it is written until the last tick it is read. Blocks
+// whose lifetimes do not overlap may share memory, and Solve() packs them
+// greedily, largest first, at the lowest offset that does not collide with
+// any block already placed that is live at the same time.
+//
+// When a value is last read:
+//  - by its parent's f_eval, unless b_eval needs it too.
+//  - by a seed expression handed down in b_eval. Elementwise nodes hold no
+//    adjoint and pass seeds down lazily, so a seed is only evaluated when
+//    it reaches a node that accumulates it (a MatMul or a leaf). PlanReverse
+//    returns that tick.
+// MatMul adjoints live from their own b_eval until both children consumed
+// the seeds made from them. Leaf adjoints are the result and live forever.
+struct BufferPlan {
+  static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+  struct Block {
+    std::size_t size_;
+    std::size_t begin_;
+    std::size_t end_;
+    std::size_t offset_;
+  };
+  std::vector<Block> values_;
+  std::vector<Block> adjoints_;
+  std::size_t clock_{0};
+  std::size_t value_size_{0};
+  std::size_t adjoint_size_{0};
+
+  STRONG_INLINE std::size_t tick() { return clock_++; }
+
+  STRONG_INLINE std::size_t add_value(std::size_t size, std::size_t t) {
+    values_.push_back({size, t, t, 0});
+    return values_.size() - 1;
+  }
+  // Extend the life of a value to tick t. npos ids are external values.
+  STRONG_INLINE void use_value(std::size_t id, std::size_t t) {
+    if (id != npos) {
+      values_[id].end_ = std::max(values_[id].end_, t);
+    }
+  }
+  STRONG_INLINE std::size_t add_adjoint(std::size_t size, std::size_t begin,
+                                        std::size_t end) {
+    adjoints_.push_back({size, begin, end, 0});
+    return adjoints_.size() - 1;
+  }
+
+  // Assign offsets, after which value_size_ and adjoint_size_ hold the
+  // number of doubles each buffer needs.
+  inline void Solve() {
+    value_size_ = pack(values_);
+    adjoint_size_ = pack(adjoints_);
+  }
+
+  static inline std::size_t pack(std::vector<Block>& blocks) {
+    std::vector<std::size_t> order(blocks.size());
+    for (std::size_t i = 0; i < order.size(); ++i) {
+      order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](auto a, auto b) {
+      return blocks[a].size_ > blocks[b].size_;
+    });
+    std::vector<std::size_t> placed;
+    std::vector<std::pair<std::size_t, std::size_t>> taken;
+    std::size_t total = 0;
+    for (auto i : order) {
+      auto& block = blocks[i];
+      taken.clear();
+      for (auto j : placed) {
+        const auto& other = blocks[j];
+        if (other.begin_ <= block.end_ && block.begin_ <= other.end_) {
+          taken.emplace_back(other.offset_, other.offset_ + other.size_);
+        }
+      }
+      std::sort(taken.begin(), taken.end());
+      std::size_t offset = 0;
+      for (auto [begin, end] : taken) {
+        if (offset + block.size_ <= begin) {
+          break;
+        }
+        offset = std::max(offset, end);
+      }
+      block.offset_ = offset;
+      total = std::max(total, offset + block.size_);
+      placed.push_back(i);
+    }
+    return total;
+  }
+};
+
+// ----------------------------- Passes -------------------------------
+// A node with several parents (a shared Var, or a Shared subexpression) is
+// visited once per parent by CacheBindSize, Bind and Plan. Each of the free
+// functions starts a new pass and a shared node only sizes, binds or plans
+// itself on its first visit of the pass, counting its parents on the rest.
+namespace detail {
+STRONG_INLINE std::size_t& bind_pass() {
+  static std::size_t pass = 0;
+  return pass;
+}
+// True on the first call with `seen` in the current pass.
+STRONG_INLINE bool first_visit(std::size_t& seen) {
+  if (seen == bind_pass()) {
+    return false;
+  }
+  seen = bind_pass();
+  return true;
+}
+
+// Binding of a leaf, held by every copy of the Var so that all of them
+// accumulate into one adjoint.
+struct LeafSlot {
+  double* adj_ptr_{nullptr};
+  std::size_t adj_id_{0};
+  std::size_t pass_{0};
+};
+}  // namespace detail
+
 // ------------------------------ Var ---------------------------------
 // Leaf node holding dynamic (rows x cols) matrices for value/adjoint.
 // Does not allocate at construction; it binds to external contiguous
 // buffers later (lazy allocation). It keeps an initial value to copy
 // into the bound value buffer during f_eval().
+// Copies of a Var are the same leaf: they share one adjoint, so a Var used
+// in several places of an expression is bound once.
 template <typename T>
 requires EigenMatrix<T>
 struct Var<T> {
  static constexpr std::size_t ops = 1;
+ static constexpr bool accumulates = true;
  using mat_type = std::decay_t<T>;
   template <typename T1>
   requires EigenMatrix<T1>
   Var(T1&& init_value)
       : rows_(init_value.rows()), cols_(init_value.cols()), 
-        value_ptr_(init_value.data()), adj_ptr_(nullptr) {
+        value_ptr_(init_value.data()), slot_(std::make_shared<detail::LeafSlot>()) {
   }
   template <typename T1, typename T2>
   Var(T1&& init_value, T2&& init_adjoint)
       : rows_(init_value.rows()), cols_(init_value.cols()), 
-        value_ptr_(init_value.data()), adj_ptr_(init_adjoint.data()) {
+        value_ptr_(init_value.data()), slot_(std::make_shared<detail::LeafSlot>()) {
+    slot_->adj_ptr_ = init_adjoint.data();
   }
   Var(Eigen::Index rows, Eigen::Index cols)
       : rows_(rows), cols_(cols),
-        value_ptr_(nullptr), adj_ptr_(nullptr) {
+        value_ptr_(nullptr), slot_(std::make_shared<detail::LeafSlot>()) {
   }
 
   // Memory sizing (in number of doubles).
-  constexpr STRONG_INLINE std::pair<std::size_t, std::size_t> CacheBindSize() const {
+  STRONG_INLINE std::pair<std::size_t, std::size_t> CacheBindSize() const {
+    if (!detail::first_visit(slot_->pass_)) {
+      return {0, 0};
+    }
     return {0, rows_ * cols_};
   }
 
   // Bind this node to segments within the provided contiguous buffers.
-  constexpr STRONG_INLINE void Bind(double __restrict* values_base, double __restrict* adjs_base,
+  STRONG_INLINE void Bind(double __restrict* values_base, double __restrict* adjs_base,
             std::size_t& v_off, std::size_t& a_off) {
-    adj_ptr_ = adjs_base + a_off;
+    if (!detail::first_visit(slot_->pass_)) {
+      return;
+    }
+    slot_->adj_ptr_ = adjs_base + a_off;
     a_off += static_cast<std::size_t>(rows_) * cols_;
   }
 
+  STRONG_INLINE void PlanForward(BufferPlan& plan) {
+    if (!detail::first_visit(slot_->pass_)) {
+      return;
+    }
+    slot_->adj_id_ = plan.add_adjoint(static_cast<std::size_t>(rows_) * cols_, 0,
+                                      BufferPlan::npos);
+  }
+  STRONG_INLINE std::size_t PlanReverse(BufferPlan& plan) {
+    return plan.tick();
+  }
+  STRONG_INLINE void Bind(const BufferPlan& plan, double __restrict*,
+            double __restrict* adjs_base) {
+    if (!detail::first_visit(slot_->pass_)) {
+      return;
+    }
+    slot_->adj_ptr_ = adjs_base + plan.adjoints_[slot_->adj_id_].offset_;
+  }
+  // The value is the caller's matrix, not part of any buffer.
+  STRONG_INLINE std::size_t value_id() const { return BufferPlan::npos; }
+
   STRONG_INLINE constexpr auto f_eval() {
     return this->value_map();
   }
@@ -99,7 +289,12 @@ struct Var<T> {
   // b_eval: leaf (no children).
   template <typename TT>
   STRONG_INLINE constexpr void b_eval(TT&& seed) {
-    this->adjoint_map().noalias() += std::forward<TT>(seed);
+    this->adjoint_map().array() += seed_array(seed, rows_, cols_);
+  }
+  // `gemm(dst, accumulate)` writes the seed into our slab.
+  template <typename F>
+  STRONG_INLINE void b_eval_gemm(F&& gemm) {
+    gemm(slot_->adj_ptr_, true);
   }
 
   // Access mapped views (created on demand).
@@ -107,7 +302,7 @@ struct Var<T> {
     return Eigen::Map<const Eigen::MatrixXd>(value_ptr_, rows_, cols_); 
   }
   STRONG_INLINE auto adjoint_map() { 
-    return Eigen::Map<Eigen::MatrixXd>(adj_ptr_, rows_, cols_); 
+    return Eigen::Map<Eigen::MatrixXd>(slot_->adj_ptr_, rows_, cols_); 
   }
 
   STRONG_INLINE Eigen::Index rows() const { return rows_; }
@@ -115,8 +310,8 @@ struct Var<T> {
 
   Eigen::Index rows_;
   Eigen::Index cols_;
-  double __restrict* value_ptr_;     // bound at Bind()
-  double __restrict* adj_ptr_;       // bound at Bind()
+  double __restrict* value_ptr_;
+  std::shared_ptr<detail::LeafSlot> slot_;  // bound at Bind()
 };
 
 template <std::size_t start, std::size_t slice_size, typename... Args>
@@ -129,6 +324,82 @@ template <std::size_t start, std::size_t slice_size, typename... Args>
 }
 
 
+// ------------------------------ Gemm ---------------------------------
+// res (+)= lhs * rhs through Eigen's GEMM kernel, where lhs and rhs are maps
+// of bound slabs, possibly transposed. Eigen's product allocates its packing
+// buffers on every call once they outgrow the stack limit. A Gemm allocates
+// them once at Bind() for the shape it is used with, so the sweeps do not
+// touch the heap. Products under Eigen's coefficient based threshold go
+// through Eigen, which evaluates them straight into the destination.
+template <typename X>
+struct GemmOperand {
+  static constexpr int order = Eigen::ColMajor;
+  static STRONG_INLINE const double* data(const X& x) { return x.data(); }
+  static STRONG_INLINE Eigen::Index stride(const X& x) { return x.outerStride(); }
+};
+// A transposed column major slab is the same memory read row major.
+template <typename X>
+struct GemmOperand<Eigen::Transpose<X>> {
+  using nested = GemmOperand<std::remove_const_t<X>>;
+  static constexpr int order
+      = nested::order == Eigen::ColMajor ? Eigen::RowMajor : Eigen::ColMajor;
+  static STRONG_INLINE const double* data(const Eigen::Transpose<X>& x) {
+    return nested::data(x.nestedExpression());
+  }
+  static STRONG_INLINE Eigen::Index stride(const Eigen::Transpose<X>& x) {
+    return nested::stride(x.nestedExpression());
+  }
+};
+
+struct Gemm {
+  using blocking_t = Eigen::internal::gemm_blocking_space<
+      Eigen::ColMajor, double, double, Eigen::Dynamic, Eigen::Dynamic, Eigen::Dynamic>;
+
+  // Allocate the packing buffers for a rows x depth times depth x cols product.
+  inline void reserve(Eigen::Index rows, Eigen::Index cols, Eigen::Index depth) {
+    if (rows + cols + depth < EIGEN_GEMM_TO_COEFFBASED_THRESHOLD) {
+      blocking_.reset();
+      return;
+    }
+    blocking_ = std::make_shared<blocking_t>(rows, cols, depth, 1, true);
+    blocking_->allocateAll();
+  }
+
+  // Adds the product into res, or overwrites res if `accumulate` is false.
+  template <typename L, typename R>
+  STRONG_INLINE void run(const L& lhs, const R& rhs, double* res, bool accumulate) {
+    Eigen::Map<Eigen::MatrixXd> dst(res, lhs.rows(), rhs.cols());
+    if (!blocking_) {
+      if (accumulate) {
+        dst.noalias() += lhs * rhs;
+      } else {
+        dst.noalias() = lhs * rhs;
+      }
+      return;
+    }
+    if (!accumulate) {
+      dst.setZero();
+    }
+    using lhs_t = GemmOperand<L>;
+    using rhs_t = GemmOperand<R>;
+    Eigen::internal::general_matrix_matrix_product<
+        Eigen::Index, double, lhs_t::order, false, double, rhs_t::order, false,
+        Eigen::ColMajor, 1>::run(lhs.rows(), rhs.cols(), lhs.cols(),
+                                 lhs_t::data(lhs), lhs_t::stride(lhs),
+                                 rhs_t::data(rhs), rhs_t::stride(rhs),
+                                 res, 1, lhs.rows(), 1.0, *blocking_);
+  }
+
+  // Copies made before Bind() share nothing yet; shared so nodes stay copyable.
+  std::shared_ptr<blocking_t> blocking_;
+};
+
+// Nodes owning an adjoint slab (Var, MatMul, Shared). A MatMul writes the
+// adjoint of such a child with a GEMM straight into its slab; other children
+// get the product through a scratch slab of the MatMul.
+template <typename T>
+concept Accumulator = std::decay_t<T>::accumulates;
+
 // ---------------------------- MatMul -------------------------------
 // Static binary node: C = Left * Right (matrix × matrix).
 template <typename Left, typename Right>
@@ -136,6 +407,7 @@ struct MatMul {
   using Left_ = std::decay_t<Left>;
   using Right_ = std::decay_t<Right>;
   static constexpr std::size_t ops = 2;
+  static constexpr bool accumulates = true;
   template <typename L, typename R>
   MatMul(L&& left, R&& right)
       : left_(std::forward<L>(left)), right_(std::forward<R>(right)),
@@ -148,7 +420,7 @@ struct MatMul {
     const std::size_t n = static_cast<std::size_t>(rows_) * cols_;
     auto [lv, la] = left_.CacheBindSize();
     auto [rv, ra] = right_.CacheBindSize();
-    return {n + lv + rv, n + la + ra};
+    return {n + lv + rv, n + la + ra + left_scratch_size() + right_scratch_size()};
   }
 
   STRONG_INLINE void Bind(double __restrict* values_base, double __restrict* adjs_base,
@@ -158,22 +430,126 @@ struct MatMul {
     adj_ptr_ = adjs_base + a_off;
     v_off += static_cast<std::size_t>(rows_) * cols_;
     a_off += static_cast<std::size_t>(rows_) * cols_;
+    left_scratch_ = adjs_base + a_off;
+    a_off += left_scratch_size();
+    right_scratch_ = adjs_base + a_off;
+    a_off += right_scratch_size();
+    ReserveGemms();
     left_.Bind(values_base, adjs_base, v_off, a_off);
     right_.Bind(values_base, adjs_base, v_off, a_off);
   }
+
+  STRONG_INLINE void PlanForward(BufferPlan& plan) {
+    left_.PlanForward(plan);
+    right_.PlanForward(plan);
+    const auto t = plan.tick();
+    value_id_ = plan.add_value(static_cast<std::size_t>(rows_) * cols_, t);
+    plan.use_value(left_.value_id(), t);
+    plan.use_value(right_.value_id(), t);
+  }
+  STRONG_INLINE std::size_t PlanReverse(BufferPlan& plan) {
+    const auto t = plan.tick();
+    const auto l = left_.PlanReverse(plan);
+    // dR is computed once the left subtree is done.
+    const auto tr = plan.tick();
+    const auto r = right_.PlanReverse(plan);
+    // dL reads our adjoint and R, dR reads our adjoint and L.
+    adj_id_ = plan.add_adjoint(static_cast<std::size_t>(rows_) * cols_, t, std::max(l, r));
+    plan.use_value(right_.value_id(), l);
+    plan.use_value(left_.value_id(), r);
+    // A scratch slab lives until the child's subtree consumed it.
+    if (left_scratch_size() != 0) {
+      left_scratch_id_ = plan.add_adjoint(left_scratch_size(), t, l);
+    }
+    if (right_scratch_size() != 0) {
+      right_scratch_id_ = plan.add_adjoint(right_scratch_size(), tr, r);
+    }
+    return t;
+  }
+  STRONG_INLINE void Bind(const BufferPlan& plan, double __restrict* values_base,
+            double __restrict* adjs_base) {
+    value_ptr_ = values_base + plan.values_[value_id_].offset_;
+    adj_ptr_ = adjs_base + plan.adjoints_[adj_id_].offset_;
+    if (left_scratch_size() != 0) {
+      left_scratch_ = adjs_base + plan.adjoints_[left_scratch_id_].offset_;
+    }
+    if (right_scratch_size() != 0) {
+      right_scratch_ = adjs_base + plan.adjoints_[right_scratch_id_].offset_;
+    }
+    ReserveGemms();
+    left_.Bind(plan, values_base, adjs_base);
+    right_.Bind(plan, values_base, adjs_base);
+  }
+  STRONG_INLINE std::size_t value_id() const { return value_id_; }
+
   STRONG_INLINE auto f_eval() {
-    // value = left.value * right.value
-    return Eigen::Map<Eigen::MatrixXd>(value_ptr_, rows_, cols_).noalias() = left_.f_eval() * right_.f_eval();
+    // value = left.value * right.value. Children are evaluated in the order
+    // PlanForward assumes.
+    auto l = left_.f_eval();
+    auto r = right_.f_eval();
+    fwd_gemm_.run(l, r, value_ptr_, false);
+    return this->value_map();
   }
 
   template <typename TT>
   STRONG_INLINE void b_eval(TT&& seed) {
-    // Propagate: dL += dC * R^T ; dR += L^T * dC
-    this->adjoint_map().array() += seed;
-    auto l_adj = this->adjoint_map() * right_.value_map().transpose();
-    left_.b_eval(std::move(l_adj));
-    auto r_adj = left_.value_map().transpose() * this->adjoint_map();
-    right_.b_eval(std::move(r_adj));
+    // A node has a single parent, so the seed is its whole adjoint. Assigning
+    // it means a slab shared with other nodes needs no zeroing.
+    this->adjoint_map().array() = seed_array(seed, rows_, cols_);
+    Propagate();
+  }
+  // Seed from a parent MatMul, accumulated by `gemm` into our slab.
+  template <typename F>
+  STRONG_INLINE void b_eval_gemm(F&& gemm) {
+    gemm(adj_ptr_, false);
+    Propagate();
+  }
+
+  // dL += dC * R^T ; dR += L^T * dC
+  STRONG_INLINE void Propagate() {
+    const auto adj = this->adjoint_map();
+    {
+      const auto r_t = right_.value_map().transpose();
+      Backprop(left_, left_scratch_,
+               [&](double* dst, bool accumulate) {
+                 dl_gemm_.run(adj, r_t, dst, accumulate);
+               });
+    }
+    const auto l_t = left_.value_map().transpose();
+    Backprop(right_, right_scratch_,
+             [&](double* dst, bool accumulate) {
+               dr_gemm_.run(l_t, adj, dst, accumulate);
+             });
+  }
+  template <typename Child, typename F>
+  STRONG_INLINE void Backprop(Child& child, double* scratch, F&& run) {
+    if constexpr (Accumulator<Child>) {
+      child.b_eval_gemm(run);
+    } else {
+      run(scratch, false);
+      child.b_eval(Eigen::Map<Eigen::MatrixXd>(scratch, child.rows(), child.cols()));
+    }
+  }
+
+  STRONG_INLINE void ReserveGemms() {
+    const auto depth = left_.cols();
+    fwd_gemm_.reserve(rows_, cols_, depth);
+    dl_gemm_.reserve(rows_, depth, cols_);
+    dr_gemm_.reserve(depth, cols_, rows_);
+  }
+  STRONG_INLINE std::size_t left_scratch_size() const {
+    if constexpr (Accumulator<Left>) {
+      return 0;
+    } else {
+      return static_cast<std::size_t>(left_.rows()) * left_.cols();
+    }
+  }
+  STRONG_INLINE std::size_t right_scratch_size() const {
+    if constexpr (Accumulator<Right>) {
+      return 0;
+    } else {
+      return static_cast<std::size_t>(right_.rows()) * right_.cols();
+    }
   }
 
   STRONG_INLINE auto value_map() { return Eigen::Map<Eigen::MatrixXd>(value_ptr_, rows_, cols_); }
@@ -188,6 +564,337 @@ struct MatMul {
   Eigen::Index cols_;
   double __restrict* value_ptr_;
   double __restrict* adj_ptr_;
+  double* left_scratch_{nullptr};
+  double* right_scratch_{nullptr};
+  std::size_t value_id_{0};
+  std::size_t adj_id_{0};
+  std::size_t left_scratch_id_{0};
+  std::size_t right_scratch_id_{0};
+  Gemm fwd_gemm_;
+  Gemm dl_gemm_;
+  Gemm dr_gemm_;
+};
+
+// ------------------------ Elementwise nodes ------------------------
+// Elementwise nodes store their value so parents can read it, but own no
+// adjoint storage. Their b_eval hands the children the incoming seed with
+// the local partial folded in as one lazy expression, so a chain of
+// elementwise nodes is a single fused loop into the first node below it
+// that keeps an adjoint (a MatMul or a leaf).
+
+// Base for elementwise nodes with one child and a value buffer of the
+// child's shape.
+template <typename Child>
+struct ElementwiseBase {
+  template <typename T>
+  explicit ElementwiseBase(T&& child)
+      : child_(std::forward<T>(child)), rows_(child_.rows()),
+        cols_(child_.cols()), value_ptr_(nullptr) {}
+
+  STRONG_INLINE std::pair<std::size_t, std::size_t> CacheBindSize() const {
+    auto [cv, ca] = child_.CacheBindSize();
+    return {static_cast<std::size_t>(rows_) * cols_ + cv, ca};
+  }
+
+  STRONG_INLINE void Bind(double __restrict* values_base, double __restrict* adjs_base,
+            std::size_t& v_off, std::size_t& a_off) {
+    value_ptr_ = values_base + v_off;
+    v_off += static_cast<std::size_t>(rows_) * cols_;
+    child_.Bind(values_base, adjs_base, v_off, a_off);
+  }
+
+  STRONG_INLINE void PlanForward(BufferPlan& plan) {
+    child_.PlanForward(plan);
+    const auto t = plan.tick();
+    value_id_ = plan.add_value(static_cast<std::size_t>(rows_) * cols_, t);
+    plan.use_value(child_.value_id(), t);
+  }
+  STRONG_INLINE void Bind(const BufferPlan& plan, double __restrict* values_base,
+            double __restrict* adjs_base) {
+    value_ptr_ = values_base + plan.values_[value_id_].offset_;
+    child_.Bind(plan, values_base, adjs_base);
+  }
+  STRONG_INLINE std::size_t value_id() const { return value_id_; }
+
+  STRONG_INLINE auto value_map() { return Eigen::Map<Eigen::MatrixXd>(value_ptr_, rows_, cols_); }
+
+  STRONG_INLINE Eigen::Index rows() const { return rows_; }
+  STRONG_INLINE Eigen::Index cols() const { return cols_; }
+
+  std::decay_t<Child> child_;
+  Eigen::Index rows_;
+  Eigen::Index cols_;
+  double __restrict* value_ptr_;
+  std::size_t value_id_{0};
+};
+
+// Value and partial of the unary elementwise functions, in array form.
+// reads_value/reads_arg say whether the partial needs the node's own value
+// or its child's in the reverse pass.
+struct exp_op {
+  static constexpr bool reads_value = true;
+  static constexpr bool reads_arg = false;
+  template <typename X>
+  static STRONG_INLINE auto value(const X& x) { return x.exp(); }
+  template <typename X, typename V>
+  static STRONG_INLINE const V& partial(const X&, const V& v) { return v; }
+};
+struct log_op {
+  static constexpr bool reads_value = false;
+  static constexpr bool reads_arg = true;
+  template <typename X>
+  static STRONG_INLINE auto value(const X& x) { return x.log(); }
+  template <typename X, typename V>
+  static STRONG_INLINE auto partial(const X& x, const V&) { return x.inverse(); }
+};
+struct square_op {
+  static constexpr bool reads_value = false;
+  static constexpr bool reads_arg = true;
+  template <typename X>
+  static STRONG_INLINE auto value(const X& x) { return x.square(); }
+  template <typename X, typename V>
+  static STRONG_INLINE auto partial(const X& x, const V&) { return 2.0 * x; }
+};
+
+// ------------------------- Unary (exp/log/square) ------------------
+template <typename Child, typename Op>
+struct Unary : ElementwiseBase<Child> {
+  static constexpr std::size_t ops = 1;
+  using ElementwiseBase<Child>::ElementwiseBase;
+  STRONG_INLINE std::size_t PlanReverse(BufferPlan& plan) {
+    const auto c = this->child_.PlanReverse(plan);
+    if constexpr (Op::reads_value) {
+      plan.use_value(this->value_id_, c);
+    }
+    if constexpr (Op::reads_arg) {
+      plan.use_value(this->child_.value_id(), c);
+    }
+    return c;
+  }
+  STRONG_INLINE auto f_eval() {
+    auto v = this->value_map();
+    v.array() = Op::value(this->child_.f_eval().array());
+    return v;
+  }
+  template <typename TT>
+  STRONG_INLINE void b_eval(TT&& seed) {
+    auto x = this->child_.value_map().array();
+    auto v = this->value_map().array();
+    this->child_.b_eval(
+        (seed_array(seed, this->rows_, this->cols_) * Op::partial(x, v)).matrix());
+  }
+};
+
+// ------------------------------ Scale ------------------------------
+// c * child for a constant c.
+template <typename Child>
+struct Scale : ElementwiseBase<Child> {
+  static constexpr std::size_t ops = 1;
+  template <typename T>
+  Scale(double c, T&& child)
+      : ElementwiseBase<Child>(std::forward<T>(child)), c_(c) {}
+  STRONG_INLINE std::size_t PlanReverse(BufferPlan& plan) {
+    return this->child_.PlanReverse(plan);
+  }
+  STRONG_INLINE auto f_eval() {
+    auto v = this->value_map();
+    v.noalias() = c_ * this->child_.f_eval();
+    return v;
+  }
+  template <typename TT>
+  STRONG_INLINE void b_eval(TT&& seed) {
+    this->child_.b_eval((c_ * seed_array(seed, this->rows_, this->cols_)).matrix());
+  }
+  double c_;
+};
+
+// ---------------------------- Transpose ----------------------------
+// No storage of its own, the value is a transposed view of the child's.
+template <typename Child>
+struct Transpose {
+  static constexpr std::size_t ops = 1;
+  template <typename T>
+  explicit Transpose(T&& child) : child_(std::forward<T>(child)) {}
+
+  STRONG_INLINE std::pair<std::size_t, std::size_t> CacheBindSize() const {
+    return child_.CacheBindSize();
+  }
+  STRONG_INLINE void Bind(double __restrict* values_base, double __restrict* adjs_base,
+            std::size_t& v_off, std::size_t& a_off) {
+    child_.Bind(values_base, adjs_base, v_off, a_off);
+  }
+  STRONG_INLINE void PlanForward(BufferPlan& plan) { child_.PlanForward(plan); }
+  STRONG_INLINE std::size_t PlanReverse(BufferPlan& plan) {
+    return child_.PlanReverse(plan);
+  }
+  STRONG_INLINE void Bind(const BufferPlan& plan, double __restrict* values_base,
+            double __restrict* adjs_base) {
+    child_.Bind(plan, values_base, adjs_base);
+  }
+  STRONG_INLINE std::size_t value_id() const { return child_.value_id(); }
+  STRONG_INLINE auto f_eval() { return child_.f_eval().transpose(); }
+  template <typename TT>
+  STRONG_INLINE void b_eval(TT&& seed) {
+    child_.b_eval(seed_array(seed, rows(), cols()).matrix().transpose());
+  }
+  STRONG_INLINE auto value_map() { return child_.value_map().transpose(); }
+
+  STRONG_INLINE Eigen::Index rows() const { return child_.cols(); }
+  STRONG_INLINE Eigen::Index cols() const { return child_.rows(); }
+
+  std::decay_t<Child> child_;
+};
+
+// Base for elementwise nodes with two children of the same shape.
+template <typename Left, typename Right>
+struct ElementwiseBinaryBase {
+  template <typename L, typename R>
+  ElementwiseBinaryBase(L&& left, R&& right)
+      : left_(std::forward<L>(left)), right_(std::forward<R>(right)),
+        rows_(left_.rows()), cols_(left_.cols()), value_ptr_(nullptr) {
+    assert(left_.rows() == right_.rows() && left_.cols() == right_.cols());
+  }
+
+  STRONG_INLINE std::pair<std::size_t, std::size_t> CacheBindSize() const {
+    auto [lv, la] = left_.CacheBindSize();
+    auto [rv, ra] = right_.CacheBindSize();
+    return {static_cast<std::size_t>(rows_) * cols_ + lv + rv, la + ra};
+  }
+
+  STRONG_INLINE void Bind(double __restrict* values_base, double __restrict* adjs_base,
+            std::size_t& v_off, std::size_t& a_off) {
+    value_ptr_ = values_base + v_off;
+    v_off += static_cast<std::size_t>(rows_) * cols_;
+    left_.Bind(values_base, adjs_base, v_off, a_off);
+    right_.Bind(values_base, adjs_base, v_off, a_off);
+  }
+
+  STRONG_INLINE void PlanForward(BufferPlan& plan) {
+    left_.PlanForward(plan);
+    right_.PlanForward(plan);
+    const auto t = plan.tick();
+    value_id_ = plan.add_value(static_cast<std::size_t>(rows_) * cols_, t);
+    plan.use_value(left_.value_id(), t);
+    plan.use_value(right_.value_id(), t);
+  }
+  // Add, Sub and Select read no values in reverse.
+  STRONG_INLINE std::size_t PlanReverse(BufferPlan& plan) {
+    const auto l = left_.PlanReverse(plan);
+    const auto r = right_.PlanReverse(plan);
+    return std::max(l, r);
+  }
+  STRONG_INLINE void Bind(const BufferPlan& plan, double __restrict* values_base,
+            double __restrict* adjs_base) {
+    value_ptr_ = values_base + plan.values_[value_id_].offset_;
+    left_.Bind(plan, values_base, adjs_base);
+    right_.Bind(plan, values_base, adjs_base);
+  }
+  STRONG_INLINE std::size_t value_id() const { return value_id_; }
+
+  STRONG_INLINE auto value_map() { return Eigen::Map<Eigen::MatrixXd>(value_ptr_, rows_, cols_); }
+
+  STRONG_INLINE Eigen::Index rows() const { return rows_; }
+  STRONG_INLINE Eigen::Index cols() const { return cols_; }
+
+  std::decay_t<Left> left_;
+  std::decay_t<Right> right_;
+  Eigen::Index rows_;
+  Eigen::Index cols_;
+  double __restrict* value_ptr_;
+  std::size_t value_id_{0};
+};
+
+// ---------------------------- Add / Sub ----------------------------
+template <typename Left, typename Right>
+struct Add : ElementwiseBinaryBase<Left, Right> {
+  static constexpr std::size_t ops = 2;
+  using ElementwiseBinaryBase<Left, Right>::ElementwiseBinaryBase;
+  STRONG_INLINE auto f_eval() {
+    auto v = this->value_map();
+    auto l = this->left_.f_eval();
+    auto r = this->right_.f_eval();
+    v.noalias() = l + r;
+    return v;
+  }
+  template <typename TT>
+  STRONG_INLINE void b_eval(TT&& seed) {
+    this->left_.b_eval(seed_array(seed, this->rows_, this->cols_).matrix());
+    this->right_.b_eval(seed_array(seed, this->rows_, this->cols_).matrix());
+  }
+};
+
+template <typename Left, typename Right>
+struct Sub : ElementwiseBinaryBase<Left, Right> {
+  static constexpr std::size_t ops = 2;
+  using ElementwiseBinaryBase<Left, Right>::ElementwiseBinaryBase;
+  STRONG_INLINE auto f_eval() {
+    auto v = this->value_map();
+    auto l = this->left_.f_eval();
+    auto r = this->right_.f_eval();
+    v.noalias() = l - r;
+    return v;
+  }
+  template <typename TT>
+  STRONG_INLINE void b_eval(TT&& seed) {
+    this->left_.b_eval(seed_array(seed, this->rows_, this->cols_).matrix());
+    this->right_.b_eval((-seed_array(seed, this->rows_, this->cols_)).matrix());
+  }
+};
+
+// ---------------------------- Hadamard -----------------------------
+// Elementwise product.
+template <typename Left, typename Right>
+struct Hadamard : ElementwiseBinaryBase<Left, Right> {
+  static constexpr std::size_t ops = 2;
+  using ElementwiseBinaryBase<Left, Right>::ElementwiseBinaryBase;
+  STRONG_INLINE std::size_t PlanReverse(BufferPlan& plan) {
+    const auto l = this->left_.PlanReverse(plan);
+    const auto r = this->right_.PlanReverse(plan);
+    plan.use_value(this->right_.value_id(), l);
+    plan.use_value(this->left_.value_id(), r);
+    return std::max(l, r);
+  }
+  STRONG_INLINE auto f_eval() {
+    auto v = this->value_map();
+    auto l = this->left_.f_eval();
+    auto r = this->right_.f_eval();
+    v.array() = l.array() * r.array();
+    return v;
+  }
+  template <typename TT>
+  STRONG_INLINE void b_eval(TT&& seed) {
+    auto l = this->left_.value_map().array();
+    auto r = this->right_.value_map().array();
+    this->left_.b_eval((seed_array(seed, this->rows_, this->cols_) * r).matrix());
+    this->right_.b_eval((seed_array(seed, this->rows_, this->cols_) * l).matrix());
+  }
+};
+
+// ----------------------------- Select ------------------------------
+// mask ? left : right elementwise, for a constant boolean mask. The node owns
+// its copy of the mask, so it may be built from a temporary like `A > 0`.
+template <typename Left, typename Right>
+struct Select : ElementwiseBinaryBase<Left, Right> {
+  static constexpr std::size_t ops = 2;
+  template <typename L, typename R>
+  Select(Eigen::Array<bool, -1, -1> mask, L&& left, R&& right)
+      : ElementwiseBinaryBase<Left, Right>(std::forward<L>(left), std::forward<R>(right)),
+        mask_(std::move(mask)) {}
+  STRONG_INLINE auto f_eval() {
+    auto v = this->value_map();
+    auto l = this->left_.f_eval();
+    auto r = this->right_.f_eval();
+    v.array() = mask_.select(l.array(), r.array());
+    return v;
+  }
+  template <typename TT>
+  STRONG_INLINE void b_eval(TT&& seed) {
+    this->left_.b_eval(
+        mask_.select(seed_array(seed, this->rows_, this->cols_), 0.0).matrix());
+    this->right_.b_eval(
+        mask_.select(0.0, seed_array(seed, this->rows_, this->cols_)).matrix());
+  }
+  Eigen::Array<bool, -1, -1> mask_;
 };
 
 // ------------------------------ Sum --------------------------------
@@ -208,6 +915,17 @@ struct Sum {
             std::size_t& v_off, std::size_t& a_off) {
     child_.Bind(values_base, adjs_base, v_off, a_off);
   }
+  STRONG_INLINE void PlanForward(BufferPlan& plan) {
+    child_.PlanForward(plan);
+    plan.use_value(child_.value_id(), plan.tick());
+  }
+  STRONG_INLINE std::size_t PlanReverse(BufferPlan& plan) {
+    return child_.PlanReverse(plan);
+  }
+  STRONG_INLINE void Bind(const BufferPlan& plan, double __restrict* values_base,
+            double __restrict* adjs_base) {
+    child_.Bind(plan, values_base, adjs_base);
+  }
   STRONG_INLINE auto f_eval() {
     return val_ = child_.f_eval().sum();
   }
@@ -227,30 +945,232 @@ struct Sum {
   double adj_;
 };
 
+// ----------------------------- Shared ------------------------------
+// A subexpression used by several parents, made with share(). Copies of a
+// Shared are the same node: its value is computed on the first f_eval of a
+// sweep and reused by the other parents, and the seeds of all parents are
+// summed into its adjoint before the last one propagates it to the child.
+template <typename Child>
+struct Shared {
+  static constexpr std::size_t ops = 0;
+  static constexpr bool accumulates = true;
+  struct State {
+    Child child_;
+    std::size_t pass_{0};
+    std::size_t parents_{0};
+    std::size_t fwd_seen_{0};
+    std::size_t rev_seen_{0};
+    double __restrict* adj_ptr_{nullptr};
+    std::size_t adj_id_{0};
+  };
+
+  template <typename T>
+  requires(!std::is_same_v<std::decay_t<T>, Shared>)
+  explicit Shared(T&& child)
+      : state_(std::make_shared<State>(State{std::forward<T>(child)})) {}
+
+  STRONG_INLINE std::pair<std::size_t, std::size_t> CacheBindSize() const {
+    if (!detail::first_visit(state_->pass_)) {
+      ++state_->parents_;
+      return {0, 0};
+    }
+    state_->parents_ = 1;
+    auto [v, a] = state_->child_.CacheBindSize();
+    return {v, a + size()};
+  }
+  STRONG_INLINE void Bind(double __restrict* values_base, double __restrict* adjs_base,
+            std::size_t& v_off, std::size_t& a_off) {
+    if (!detail::first_visit(state_->pass_)) {
+      ++state_->parents_;
+      return;
+    }
+    state_->parents_ = 1;
+    state_->adj_ptr_ = adjs_base + a_off;
+    a_off += size();
+    state_->child_.Bind(values_base, adjs_base, v_off, a_off);
+  }
+
+  STRONG_INLINE void PlanForward(BufferPlan& plan) {
+    if (!detail::first_visit(state_->pass_)) {
+      ++state_->parents_;
+      return;
+    }
+    state_->parents_ = 1;
+    state_->rev_seen_ = 0;
+    state_->child_.PlanForward(plan);
+  }
+  // Every parent's seed is evaluated into the adjoint when it arrives, and
+  // the adjoint lives until the child consumed it after the last parent.
+  STRONG_INLINE std::size_t PlanReverse(BufferPlan& plan) {
+    const auto t = plan.tick();
+    if (state_->rev_seen_ == 0) {
+      state_->adj_id_ = plan.add_adjoint(size(), t, t);
+    }
+    if (++state_->rev_seen_ == state_->parents_) {
+      state_->rev_seen_ = 0;
+      const auto c = state_->child_.PlanReverse(plan);
+      auto& block = plan.adjoints_[state_->adj_id_];
+      block.end_ = std::max(block.end_, c);
+    }
+    return t;
+  }
+  STRONG_INLINE void Bind(const BufferPlan& plan, double __restrict* values_base,
+            double __restrict* adjs_base) {
+    if (!detail::first_visit(state_->pass_)) {
+      return;
+    }
+    state_->adj_ptr_ = adjs_base + plan.adjoints_[state_->adj_id_].offset_;
+    state_->child_.Bind(plan, values_base, adjs_base);
+  }
+  STRONG_INLINE std::size_t value_id() const { return state_->child_.value_id(); }
+
+  STRONG_INLINE auto f_eval() {
+    auto& s = *state_;
+    if (s.fwd_seen_++ == 0) {
+      s.child_.f_eval();
+    }
+    if (s.fwd_seen_ == s.parents_) {
+      s.fwd_seen_ = 0;
+    }
+    return s.child_.value_map();
+  }
+  template <typename TT>
+  STRONG_INLINE void b_eval(TT&& seed) {
+    auto& s = *state_;
+    if (s.rev_seen_ == 0) {
+      this->adjoint_map().array() = seed_array(seed, rows(), cols());
+    } else {
+      this->adjoint_map().array() += seed_array(seed, rows(), cols());
+    }
+    Arrived();
+  }
+  template <typename F>
+  STRONG_INLINE void b_eval_gemm(F&& gemm) {
+    gemm(state_->adj_ptr_, state_->rev_seen_ != 0);
+    Arrived();
+  }
+  // Propagate once the last parent's seed is in.
+  STRONG_INLINE void Arrived() {
+    auto& s = *state_;
+    if (++s.rev_seen_ == s.parents_) {
+      s.rev_seen_ = 0;
+      s.child_.b_eval(this->adjoint_map());
+    }
+  }
+
+  STRONG_INLINE auto value_map() { return state_->child_.value_map(); }
+  STRONG_INLINE auto adjoint_map() {
+    return Eigen::Map<Eigen::MatrixXd>(state_->adj_ptr_, rows(), cols());
+  }
+
+  STRONG_INLINE Eigen::Index rows() const { return state_->child_.rows(); }
+  STRONG_INLINE Eigen::Index cols() const { return state_->child_.cols(); }
+  STRONG_INLINE std::size_t size() const {
+    return static_cast<std::size_t>(rows()) * cols();
+  }
+
+  std::shared_ptr<State> state_;
+};
+
 // ---------------------------- Utility -------------------------------
 
 template <typename Expr>
 STRONG_INLINE std::pair<std::size_t, std::size_t> CacheBindSize(Expr&& expr) {
+  ++detail::bind_pass();
   return expr.CacheBindSize();
 }
 
 template <typename Expr>
 STRONG_INLINE void Bind(Expr&& expr, double __restrict* values_base, double __restrict* adjs_base) {
   std::size_t v_off = 0, a_off = 0;
+  ++detail::bind_pass();
   expr.Bind(values_base, adjs_base, v_off, a_off);
 }
 
+// Plan buffers with liveness, see BufferPlan. value_size_ and
+// adjoint_size_ of the result are the buffer sizes to pass to Bind().
+template <typename Expr>
+inline BufferPlan Plan(Expr&& expr) {
+  BufferPlan plan;
+  ++detail::bind_pass();
+  expr.PlanForward(plan);
+  expr.PlanReverse(plan);
+  plan.Solve();
+  return plan;
+}
+
+template <typename Expr>
+STRONG_INLINE void Bind(Expr&& expr, const BufferPlan& plan,
+                        double __restrict* values_base, double __restrict* adjs_base) {
+  ++detail::bind_pass();
+  expr.Bind(plan, values_base, adjs_base);
+}
+
+// Print the bytes the naive layout (CacheBindSize) and the planned layout
+// need for each buffer.
+template <typename Expr>
+inline void PlanReport(std::ostream& os, Expr&& expr, const BufferPlan& plan) {
+  auto [naive_v, naive_a] = CacheBindSize(expr);
+  os << "values:   " << plan.values_.size() << " blocks, naive "
+     << naive_v * sizeof(double) << " bytes, planned "
+     << plan.value_size_ * sizeof(double) << " bytes\n"
+     << "adjoints: " << plan.adjoints_.size() << " blocks, naive "
+     << naive_a * sizeof(double) << " bytes, planned "
+     << plan.adjoint_size_ * sizeof(double) << " bytes\n";
+}
+
 template <typename Expr>
 STRONG_INLINE void AutoDiff(Expr&& expr) {
   expr.f_eval();
   expr.b_eval(1.0);
 }
 
-template <typename Op1, typename Op2>
+template <ExprNode Op1, ExprNode Op2>
 STRONG_INLINE auto operator*(Op1&& left, Op2&& right) {
   return MatMul<Op1, Op2>(std::forward<Op1>(left), std::forward<Op2>(right));
 }
-template <typename Op>
+template <ExprNode Op>
+STRONG_INLINE auto operator*(double c, Op&& child) {
+  return Scale<Op>(c, std::forward<Op>(child));
+}
+template <ExprNode Op1, ExprNode Op2>
+STRONG_INLINE auto operator+(Op1&& left, Op2&& right) {
+  return Add<Op1, Op2>(std::forward<Op1>(left), std::forward<Op2>(right));
+}
+template <ExprNode Op1, ExprNode Op2>
+STRONG_INLINE auto operator-(Op1&& left, Op2&& right) {
+  return Sub<Op1, Op2>(std::forward<Op1>(left), std::forward<Op2>(right));
+}
+template <ExprNode Op1, ExprNode Op2>
+STRONG_INLINE auto elt_multiply(Op1&& left, Op2&& right) {
+  return Hadamard<Op1, Op2>(std::forward<Op1>(left), std::forward<Op2>(right));
+}
+template <ExprNode Op>
+STRONG_INLINE auto exp(Op&& child) {
+  return Unary<Op, exp_op>(std::forward<Op>(child));
+}
+template <ExprNode Op>
+STRONG_INLINE auto log(Op&& child) {
+  return Unary<Op, log_op>(std::forward<Op>(child));
+}
+template <ExprNode Op>
+STRONG_INLINE auto square(Op&& child) {
+  return Unary<Op, square_op>(std::forward<Op>(child));
+}
+template <ExprNode Op>
+STRONG_INLINE auto transpose(Op&& child) {
+  return Transpose<Op>(std::forward<Op>(child));
+}
+template <ExprNode Op1, ExprNode Op2>
+STRONG_INLINE auto select(Eigen::Array<bool, -1, -1> mask, Op1&& left, Op2&& right) {
+  return Select<Op1, Op2>(std::move(mask), std::forward<Op1>(left),
+                          std::forward<Op2>(right));
+}
+template <ExprNode Op>
+STRONG_INLINE auto share(Op&& child) {
+  return Shared<std::decay_t<Op>>(std::forward<Op>(child));
+}
+template <ExprNode Op>
 STRONG_INLINE auto sum(Op&& child) {
   return Sum<Op>(std::forward<Op>(child));
 }
@@ -277,10 +1197,140 @@ static void expr_template(benchmark::State& state) {
   values.setZero();
   adjs.setZero();
   ad::Bind(f, values.data(), adjs.data());
+  const auto allocations = heap_allocations.load();
   for (auto _ : state) {
     // 4) Autodiff (forward + reverse).
     ad::AutoDiff(f);
     adjs.setZero();
   }
+  state.counters["allocs_per_iter"] = benchmark::Counter(
+      heap_allocations.load() - allocations, benchmark::Counter::kAvgIterations);
 }
 BENCHMARK(expr_template)-> RangeMultiplier(2) -> Range(1, 4096);
+
+// A model using every node type, on six separate N x N inputs:
+//   sum(select(mask, exp(0.1 * (A * B)) .* log(C) + D, square(E') - F))
+static void expr_template_model(benchmark::State& state) {
+  const auto N = state.range(0);
+  Eigen::MatrixXd A0 = Eigen::MatrixXd::Random(N, N);
+  Eigen::MatrixXd B0 = Eigen::MatrixXd::Random(N, N);
+  Eigen::MatrixXd C0 = Eigen::MatrixXd::Random(N, N).array().abs() + 1.0;
+  Eigen::MatrixXd D0 = Eigen::MatrixXd::Random(N, N);
+  Eigen::MatrixXd E0 = Eigen::MatrixXd::Random(N, N);
+  Eigen::MatrixXd F0 = Eigen::MatrixXd::Random(N, N);
+
+  ad::Var<Eigen::MatrixXd> A(A0);
+  ad::Var<Eigen::MatrixXd> B(B0);
+  ad::Var<Eigen::MatrixXd> C(C0);
+  ad::Var<Eigen::MatrixXd> D(D0);
+  ad::Var<Eigen::MatrixXd> E(E0);
+  ad::Var<Eigen::MatrixXd> F(F0);
+  auto f = ad::sum(ad::select(
+      A0.array() > 0.0, ad::elt_multiply(ad::exp(0.1 * (A * B)), ad::log(C)) + D,
+      ad::square(ad::transpose(E)) - F));
+
+  auto [vsize, asize] = ad::CacheBindSize(f);
+  Eigen::VectorXd values(vsize);
+  Eigen::VectorXd adjs(asize);
+  values.setZero();
+  adjs.setZero();
+  ad::Bind(f, values.data(), adjs.data());
+  for (auto _ : state) {
+    ad::AutoDiff(f);
+    benchmark::DoNotOptimize(adjs.data());
+    adjs.setZero();
+  }
+}
+BENCHMARK(expr_template_model)-> RangeMultiplier(2) -> Range(1, 1024);
+
+// Deep chain x_{k+1} = c * (W * exp(x_k)) summed at the end. Only the exp
+// values and a few matrix products are live at once, so planning the buffers
+// lets most of the per-level intermediates share memory.
+template <std::size_t Depth, typename X>
+STRONG_INLINE auto deep_chain(double c, ad::Var<Eigen::MatrixXd>& W, X&& x) {
+  if constexpr (Depth == 0) {
+    return ad::sum(std::forward<X>(x));
+  } else {
+    return deep_chain<Depth - 1>(c, W, c * (W * ad::exp(std::forward<X>(x))));
+  }
+}
+
+template <bool Planned>
+static void expr_template_deep_chain(benchmark::State& state) {
+  const auto N = state.range(0);
+  Eigen::MatrixXd W0 = Eigen::MatrixXd::Random(N, N);
+  Eigen::MatrixXd X0 = Eigen::MatrixXd::Random(N, N);
+  ad::Var<Eigen::MatrixXd> W(W0);
+  ad::Var<Eigen::MatrixXd> X(X0);
+  auto f = deep_chain<16>(1.0 / N, W, X);
+
+  Eigen::VectorXd values;
+  Eigen::VectorXd adjs;
+  if constexpr (Planned) {
+    auto plan = ad::Plan(f);
+    values.setZero(plan.value_size_);
+    adjs.setZero(plan.adjoint_size_);
+    ad::Bind(f, plan, values.data(), adjs.data());
+    // The benchmark is set up more than once per size, report each size once.
+    static std::set<std::int64_t> reported;
+    if (reported.insert(N).second) {
+      std::cerr << "deep_chain<16> N = " << N << "\n";
+      ad::PlanReport(std::cerr, f, plan);
+    }
+  } else {
+    auto [vsize, asize] = ad::CacheBindSize(f);
+    values.setZero(vsize);
+    adjs.setZero(asize);
+    ad::Bind(f, values.data(), adjs.data());
+  }
+  for (auto _ : state) {
+    ad::AutoDiff(f);
+    benchmark::DoNotOptimize(adjs.data());
+    adjs.setZero();
+  }
+  state.counters["value_bytes"] = values.size() * sizeof(double);
+  state.counters["adjoint_bytes"] = adjs.size() * sizeof(double);
+}
+BENCHMARK(expr_template_deep_chain<false>)-> RangeMultiplier(2) -> Range(8, 512);
+BENCHMARK(expr_template_deep_chain<true>)-> RangeMultiplier(2) -> Range(8, 512);
+
+// sum(exp(AB) .* AB + AB * C) with AB = A * B. With sharing AB is computed
+// once and its adjoint propagated to A and B once; without it every use
+// rebuilds and differentiates its own copy of A * B.
+template <bool Share>
+static void expr_template_dag(benchmark::State& state) {
+  const auto N = state.range(0);
+  Eigen::MatrixXd A0 = Eigen::MatrixXd::Random(N, N);
+  Eigen::MatrixXd B0 = Eigen::MatrixXd::Random(N, N) / N;
+  Eigen::MatrixXd C0 = Eigen::MatrixXd::Random(N, N);
+  ad::Var<Eigen::MatrixXd> A(A0);
+  ad::Var<Eigen::MatrixXd> B(B0);
+  ad::Var<Eigen::MatrixXd> C(C0);
+  auto make_f = [&](auto&& AB1, auto&& AB2, auto&& AB3) {
+    return ad::sum(ad::elt_multiply(ad::exp(AB1), AB2) + AB3 * C);
+  };
+  auto f = [&] {
+    if constexpr (Share) {
+      auto AB = ad::share(A * B);
+      return make_f(AB, AB, AB);
+    } else {
+      return make_f(A * B, A * B, A * B);
+    }
+  }();
+
+  auto [vsize, asize] = ad::CacheBindSize(f);
+  Eigen::VectorXd values(vsize);
+  Eigen::VectorXd adjs(asize);
+  values.setZero();
+  adjs.setZero();
+  ad::Bind(f, values.data(), adjs.data());
+  for (auto _ : state) {
+    ad::AutoDiff(f);
+    benchmark::DoNotOptimize(adjs.data());
+    adjs.setZero();
+  }
+  state.counters["value_bytes"] = vsize * sizeof(double);
+  state.counters["adjoint_bytes"] = asize * sizeof(double);
+}
+BENCHMARK(expr_template_dag<false>)-> RangeMultiplier(2) -> Range(8, 512);
+BENCHMARK(expr_template_dag<true>)-> RangeMultiplier(2) -> Range(8, 512);
@@ -0,0 +1,117 @@
+#include <stdint.h>
+
+#include <benchmark/benchmark.h>
+#include <ad_ex/functional.hpp>
+#include <ad_ex/profile.hpp>
+#include <ad_ex/tape_stats.hpp>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// The model of lambda_eigen_bench, sum(X1 * X2), with both N x N matrices
+// packed into one input vector.
+struct matmul_sum {
+  Eigen::Index N;
+  template <typename T>
+  inline auto operator()(const Eigen::Matrix<T, -1, 1>& x) const {
+    using mat_t = Eigen::Matrix<T, -1, -1>;
+    Eigen::Map<const mat_t> X1(x.data(), N, N);
+    Eigen::Map<const mat_t> X2(x.data() + N * N, N, N);
+    return T((X1 * X2).sum());
+  }
+};
+
+// Central differences of two gradients along v.
+template <typename F>
+static void finite_diff_hessian_times_vector(const F& f,
+                                             const Eigen::VectorXd& x,
+                                             const Eigen::VectorXd& v,
+                                             double& fx, Eigen::VectorXd& hv,
+                                             double eps = 1e-6) {
+  Eigen::VectorXd g_plus;
+  Eigen::VectorXd g_minus;
+  double f_shift;
+  ad::gradient(f, x + eps * v, f_shift, g_plus);
+  ad::gradient(f, x - eps * v, f_shift, g_minus);
+  fx = f(x);
+  hv = (g_plus - g_minus) / (2 * eps);
+}
+
+// Full Hessian by one forward difference of the gradient per input, then H v.
+template <typename F>
+static void finite_diff_hessian(const F& f, const Eigen::VectorXd& x,
+                                const Eigen::VectorXd& v, double& fx,
+                                Eigen::VectorXd& hv, double eps = 1e-6) {
+  const auto n = x.size();
+  Eigen::MatrixXd H(n, n);
+  Eigen::VectorXd g;
+  Eigen::VectorXd g_i;
+  ad::gradient(f, x, fx, g);
+  Eigen::VectorXd x_i = x;
+  double f_i;
+  for (Eigen::Index i = 0; i < n; ++i) {
+    x_i(i) += eps;
+    ad::gradient(f, x_i, f_i, g_i);
+    H.col(i) = (g_i - g) / eps;
+    x_i(i) = x(i);
+  }
+  hv = H * v;
+}
+
+static void fvar_hvp_bench(benchmark::State& state) {
+  const auto N = state.range(0);
+  matmul_sum f{N};
+  Eigen::VectorXd x = Eigen::VectorXd::Random(2 * N * N);
+  Eigen::VectorXd v = Eigen::VectorXd::Random(2 * N * N);
+  Eigen::VectorXd hv;
+  double fx;
+  for (auto _ : state) {
+    ad::hessian_times_vector(f, x, v, fx, hv);
+    benchmark::DoNotOptimize(fx);
+    benchmark::DoNotOptimize(hv.data());
+  }
+  ad::report_tape_stats(state);
+  ad::report_profile(state);
+  ad::clear_mem();
+}
+BENCHMARK(fvar_hvp_bench)-> RangeMultiplier(2) -> Range(1, 64);
+
+static void finite_diff_hvp_bench(benchmark::State& state) {
+  const auto N = state.range(0);
+  matmul_sum f{N};
+  Eigen::VectorXd x = Eigen::VectorXd::Random(2 * N * N);
+  Eigen::VectorXd v = Eigen::VectorXd::Random(2 * N * N);
+  Eigen::VectorXd hv;
+  Eigen::VectorXd hv_fvar;
+  double fx;
+  for (auto _ : state) {
+    finite_diff_hessian_times_vector(f, x, v, fx, hv);
+    benchmark::DoNotOptimize(fx);
+    benchmark::DoNotOptimize(hv.data());
+  }
+  ad::hessian_times_vector(f, x, v, fx, hv_fvar);
+  state.counters["max_abs_err"] = (hv - hv_fvar).cwiseAbs().maxCoeff();
+  ad::report_tape_stats(state);
+  ad::report_profile(state);
+  ad::clear_mem();
+}
+BENCHMARK(finite_diff_hvp_bench)-> RangeMultiplier(2) -> Range(1, 64);
+
+// What N gradients by finite differences cost, 2 N^2 inputs here.
+static void finite_diff_hessian_bench(benchmark::State& state) {
+  const auto N = state.range(0);
+  matmul_sum f{N};
+  Eigen::VectorXd x = Eigen::VectorXd::Random(2 * N * N);
+  Eigen::VectorXd v = Eigen::VectorXd::Random(2 * N * N);
+  Eigen::VectorXd hv;
+  double fx;
+  for (auto _ : state) {
+    finite_diff_hessian(f, x, v, fx, hv);
+    benchmark::DoNotOptimize(fx);
+    benchmark::DoNotOptimize(hv.data());
+  }
+  ad::report_tape_stats(state);
+  ad::report_profile(state);
+  ad::clear_mem();
+}
+BENCHMARK(finite_diff_hessian_bench)-> RangeMultiplier(2) -> Range(1, 16);
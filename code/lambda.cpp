@@ -1,13 +1,116 @@
 #include <ad_ex/lambda.hpp>
+#include <ad_ex/profile.hpp>
+#include <ad_ex/tape_stats.hpp>
 #include <benchmark/benchmark.h>
 static void lambda_bench(benchmark::State& state) {
     for (auto _ : state) {
+      ad::clear_mem();
       ad::var x(2.0);
       ad::var y(4.0);
       auto z = x * log(y) + log(x * y) * y;
       ad::grad(z);
       benchmark::DoNotOptimize(z);
-      ad::clear_mem();
     }
+    ad::report_tape_stats(state);
+    ad::report_profile(state);
+    ad::clear_mem();
 }
 BENCHMARK(lambda_bench);
+
+// Repeats the expression N times so the tape grows well past the first arena
+// chunk. Items per second should stay flat as N grows.
+static void lambda_tape_size_bench(benchmark::State& state) {
+    const auto N = state.range(0);
+    for (auto _ : state) {
+      ad::clear_mem();
+      ad::var x(2.0);
+      ad::var y(4.0);
+      ad::var z(0.0);
+      for (int i = 0; i < N; ++i) {
+        z += x * log(y) + log(x * y) * y;
+      }
+      ad::grad(z);
+      benchmark::DoNotOptimize(z);
+    }
+    ad::report_tape_stats(state);
+    ad::report_profile(state);
+    ad::clear_mem();
+    state.SetItemsProcessed(state.iterations() * N);
+}
+BENCHMARK(lambda_tape_size_bench)-> RangeMultiplier(4) -> Range(1, 1 << 16);
+
+// Each benchmark thread records to its own thread local tape.
+BENCHMARK(lambda_tape_size_bench)-> Arg(1024) -> ThreadRange(1, 16) -> UseRealTime();
+
+static void lambda_stack_tape_bench(benchmark::State& state) {
+    ad::stack_tape<> t;
+    ad::tape_scope scope(t);
+    for (auto _ : state) {
+      ad::clear_mem(t);
+      ad::var x(2.0);
+      ad::var y(4.0);
+      auto z = x * log(y) + log(x * y) * y;
+      ad::grad(t, z);
+      benchmark::DoNotOptimize(z);
+    }
+    ad::report_tape_stats(state, t);
+    ad::report_profile(state);
+    ad::clear_mem(t);
+}
+BENCHMARK(lambda_stack_tape_bench);
+
+// Takes N inner gradients inside one outer gradient. Each inner gradient is
+// recorded in a nested region and rolled back, so peak tape memory does not
+// grow with N. The inner gradient runs on copies of x and y so that it does
+// not add into their outer adjoints.
+static void lambda_nested_bench(benchmark::State& state) {
+    const auto N = state.range(0);
+    for (auto _ : state) {
+      ad::clear_mem();
+      ad::var x(2.0);
+      ad::var y(4.0);
+      ad::var z(0.0);
+      for (int i = 0; i < N; ++i) {
+        double inner_grad = 0;
+        {
+          ad::nested_rev_autodiff nested;
+          ad::var x_inner(x.val());
+          ad::var y_inner(y.val());
+          auto w = x_inner * log(y_inner) + log(x_inner * y_inner) * y_inner;
+          ad::grad(w);
+          inner_grad = x_inner.adj();
+        }
+        z += x * inner_grad;
+      }
+      ad::grad(z);
+      benchmark::DoNotOptimize(z);
+    }
+    ad::report_tape_stats(state);
+    ad::report_profile(state);
+    ad::clear_mem();
+    state.SetItemsProcessed(state.iterations() * N);
+}
+BENCHMARK(lambda_nested_bench)-> RangeMultiplier(4) -> Range(1, 1 << 12);
+
+// Per node cost of the reverse tape for graphs of 10^3 to 10^7 nodes. Each
+// repeat of the expression records 7 nodes. monobuff_graph_bench builds the
+// same graph on a vector of pointers with a virtual chain() per node.
+static void lambda_graph_bench(benchmark::State& state) {
+    const auto reps = state.range(0) / 7;
+    for (auto _ : state) {
+      ad::clear_mem();
+      ad::var x(2.0);
+      ad::var y(4.0);
+      ad::var z(0.0);
+      for (int i = 0; i < reps; ++i) {
+        z += x * log(y) + log(x * y) * y;
+      }
+      ad::grad(z);
+      benchmark::DoNotOptimize(z);
+    }
+    ad::report_tape_stats(state);
+    ad::report_profile(state);
+    ad::clear_mem();
+    state.SetItemsProcessed(state.iterations() * reps * 7);
+}
+BENCHMARK(lambda_graph_bench)-> RangeMultiplier(10) -> Range(1000, 10000000);
@@ -0,0 +1,76 @@
+#include <stdint.h>
+
+#include <benchmark/benchmark.h>
+#include <ad_ex/meta/Eigen.hpp>
+#include <ad_ex/lambda.hpp>
+#include <ad_ex/eigen_numtraits.hpp>
+#include <ad_ex/var_matrix_product.hpp>
+#include <ad_ex/profile.hpp>
+#include <ad_ex/tape_stats.hpp>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <memory>
+#include <memory_resource>
+#include <ranges> // For std::views::reverse
+
+// Same model as lambda_eigen_bench. Including var_matrix_product.hpp is the
+// only change, products above the threshold now run on var<Matrix>. The
+// product and the sum are profile regions, timed when built with AD_PROFILE.
+static void lambda_eigen_promoted_bench(benchmark::State& state) {
+
+  using matv = Eigen::Matrix<ad::var, -1, -1>;
+  using matd = Eigen::Matrix<double, -1, -1>;
+  const auto N = state.range(0);
+  const auto X1_d = matd::Random(N, N);
+  const auto X2_d = matd::Random(N, N);
+  for (auto _ : state) {
+    ad::clear_mem();
+    matv X1(X1_d);
+    matv X2(X2_d);
+    matv X1X2;
+    ad::var ret;
+    {
+      ad::profile p("product");
+      X1X2 = X1 * X2;
+    }
+    {
+      ad::profile p("sum");
+      ret = X1X2.sum();
+    }
+    ad::grad(ret);
+    benchmark::DoNotOptimize(ret);
+  }
+  ad::report_tape_stats(state);
+  ad::report_profile(state);
+  ad::clear_mem();
+}
+BENCHMARK(lambda_eigen_promoted_bench)-> RangeMultiplier(2) -> Range(1, 4096);
+
+// Matrix-vector products take the same path.
+static void lambda_eigen_promoted_gemv_bench(benchmark::State& state) {
+
+  using matv = Eigen::Matrix<ad::var, -1, -1>;
+  using vecv = Eigen::Matrix<ad::var, -1, 1>;
+  using matd = Eigen::Matrix<double, -1, -1>;
+  using vecd = Eigen::Matrix<double, -1, 1>;
+  const auto N = state.range(0);
+  const matd X_d = matd::Random(N, N);
+  const vecd v_d = vecd::Random(N);
+  for (auto _ : state) {
+    ad::clear_mem();
+    matv X(X_d);
+    vecv v(v_d);
+    ad::var ret = (X * v).sum();
+    ad::grad(ret);
+    benchmark::DoNotOptimize(ret);
+  }
+  ad::report_tape_stats(state);
+  ad::report_profile(state);
+  ad::clear_mem();
+}
+BENCHMARK(lambda_eigen_promoted_gemv_bench)-> RangeMultiplier(2) -> Range(1, 4096);
@@ -4,6 +4,8 @@
 #include <ad_ex/lambda.hpp>
 #include <ad_ex/eigen_numtraits.hpp>
 #include <ad_ex/arena_matrix.hpp>
+#include <ad_ex/profile.hpp>
+#include <ad_ex/tape_stats.hpp>
 #include <benchmark/benchmark.h>
 #include <cmath>
 #include <cstddef>
@@ -61,12 +63,15 @@ static void lambda_eigen_special_bench(benchmark::State& state) {
   const auto X1_d = matd::Random(N, N);
   const auto X2_d = matd::Random(N, N);
   for (auto _ : state) {
+    ad::clear_mem();
     ad::arena_matrix<matv> X1(X1_d);
     ad::arena_matrix<matv> X2(X2_d);
     ad::var ret = (X1 * X2).sum();
     ad::grad(ret);
     benchmark::DoNotOptimize(ret);
-    ad::clear_mem();
   }
+  ad::report_tape_stats(state);
+  ad::report_profile(state);
+  ad::clear_mem();
 }
 BENCHMARK(lambda_eigen_special_bench)-> RangeMultiplier(2) -> Range(1, 4096);
@@ -0,0 +1,117 @@
+#include <stdint.h>
+
+#include <benchmark/benchmark.h>
+#include <ad_ex/lanes.hpp>
+#include <ad_ex/profile.hpp>
+#include <ad_ex/tape_stats.hpp>
+#include <vector>
+
+// lambda_bench evaluated at W points in one sweep.
+template <int W>
+static void lambda_lanes_bench(benchmark::State& state) {
+    ad::lanes<W> x_val;
+    ad::lanes<W> y_val;
+    for (int i = 0; i < W; ++i) {
+      x_val(i) = 2.0 + 0.1 * i;
+      y_val(i) = 4.0 + 0.1 * i;
+    }
+    for (auto _ : state) {
+      ad::clear_mem();
+      ad::var_lanes<W> x(x_val);
+      ad::var_lanes<W> y(y_val);
+      auto z = x * log(y) + log(x * y) * y;
+      ad::grad(z);
+      benchmark::DoNotOptimize(x.adj().data());
+      benchmark::DoNotOptimize(y.adj().data());
+    }
+    ad::report_tape_stats(state);
+    ad::report_profile(state);
+    ad::clear_mem();
+    state.SetItemsProcessed(state.iterations() * W);
+}
+BENCHMARK_TEMPLATE(lambda_lanes_bench, 1);
+BENCHMARK_TEMPLATE(lambda_lanes_bench, 2);
+BENCHMARK_TEMPLATE(lambda_lanes_bench, 4);
+BENCHMARK_TEMPLATE(lambda_lanes_bench, 8);
+
+// The same W points as W separate lambda_bench runs.
+template <int W>
+static void lambda_scalar_lanes_bench(benchmark::State& state) {
+    for (auto _ : state) {
+      for (int i = 0; i < W; ++i) {
+        ad::clear_mem();
+        ad::var x(2.0 + 0.1 * i);
+        ad::var y(4.0 + 0.1 * i);
+        auto z = x * log(y) + log(x * y) * y;
+        ad::grad(z);
+        benchmark::DoNotOptimize(x.adj());
+        benchmark::DoNotOptimize(y.adj());
+      }
+    }
+    ad::report_tape_stats(state);
+    ad::report_profile(state);
+    ad::clear_mem();
+    state.SetItemsProcessed(state.iterations() * W);
+}
+BENCHMARK_TEMPLATE(lambda_scalar_lanes_bench, 1);
+BENCHMARK_TEMPLATE(lambda_scalar_lanes_bench, 2);
+BENCHMARK_TEMPLATE(lambda_scalar_lanes_bench, 4);
+BENCHMARK_TEMPLATE(lambda_scalar_lanes_bench, 8);
+
+// Longer chains, as in lambda_graph_bench, where the per-node work rather
+// than setting up the leaves dominates.
+template <int W>
+static void lambda_lanes_graph_bench(benchmark::State& state) {
+    const auto reps = state.range(0) / 7;
+    ad::lanes<W> x_val;
+    ad::lanes<W> y_val;
+    for (int i = 0; i < W; ++i) {
+      x_val(i) = 2.0 + 0.1 * i;
+      y_val(i) = 4.0 + 0.1 * i;
+    }
+    for (auto _ : state) {
+      ad::clear_mem();
+      ad::var_lanes<W> x(x_val);
+      ad::var_lanes<W> y(y_val);
+      ad::var_lanes<W> z(ad::lanes<W>::Zero());
+      for (int i = 0; i < reps; ++i) {
+        z = z + (x * log(y) + log(x * y) * y);
+      }
+      ad::grad(z);
+      benchmark::DoNotOptimize(x.adj().data());
+    }
+    ad::report_tape_stats(state);
+    ad::report_profile(state);
+    ad::clear_mem();
+    state.SetItemsProcessed(state.iterations() * W);
+}
+BENCHMARK_TEMPLATE(lambda_lanes_graph_bench, 1)-> Arg(7000);
+BENCHMARK_TEMPLATE(lambda_lanes_graph_bench, 2)-> Arg(7000);
+BENCHMARK_TEMPLATE(lambda_lanes_graph_bench, 4)-> Arg(7000);
+BENCHMARK_TEMPLATE(lambda_lanes_graph_bench, 8)-> Arg(7000);
+
+template <int W>
+static void lambda_scalar_lanes_graph_bench(benchmark::State& state) {
+    const auto reps = state.range(0) / 7;
+    for (auto _ : state) {
+      for (int i = 0; i < W; ++i) {
+        ad::clear_mem();
+        ad::var x(2.0 + 0.1 * i);
+        ad::var y(4.0 + 0.1 * i);
+        ad::var z(0.0);
+        for (int j = 0; j < reps; ++j) {
+          z += x * log(y) + log(x * y) * y;
+        }
+        ad::grad(z);
+        benchmark::DoNotOptimize(x.adj());
+      }
+    }
+    ad::report_tape_stats(state);
+    ad::report_profile(state);
+    ad::clear_mem();
+    state.SetItemsProcessed(state.iterations() * W);
+}
+BENCHMARK_TEMPLATE(lambda_scalar_lanes_graph_bench, 1)-> Arg(7000);
+BENCHMARK_TEMPLATE(lambda_scalar_lanes_graph_bench, 2)-> Arg(7000);
+BENCHMARK_TEMPLATE(lambda_scalar_lanes_graph_bench, 4)-> Arg(7000);
+BENCHMARK_TEMPLATE(lambda_scalar_lanes_graph_bench, 8)-> Arg(7000);
@@ -5,6 +5,9 @@
 #include <ad_ex/lambda.hpp>
 #include <ad_ex/eigen_numtraits.hpp>
 #include <ad_ex/arena_matrix.hpp>
+#include <ad_ex/var_matrix.hpp>
+#include <ad_ex/profile.hpp>
+#include <ad_ex/tape_stats.hpp>
 #include <cmath>
 #include <cstddef>
 #include <cstdlib>
@@ -16,66 +19,6 @@
 #include <memory_resource>
 #include <ranges> // For std::views::reverse
 
-namespace ad {
-
-template <typename T>
-requires EigenMatrix<T>
-struct var_base<T>  : public var_base_chain {
-  arena_matrix<T> value_;
-  arena_matrix<T> adjoint_;
-  var_base(const T& x)
-      : var_base_chain(),
-        value_(x),
-        adjoint_(value_.rows(), value_.cols()) {
-    adjoint_.setZero();
-  }
-  inline auto& val() {
-    return value_;
-  }
-  inline auto& adj() {
-    return adjoint_;
-  }
-};
-
-template <typename T>
-inline constexpr bool is_matrix_var = is_eigen_v<std::decay_t<T>> && is_var_v<typename std::decay_t<T>::Scalar>;
-template <typename T>
-inline constexpr bool is_var_matrix = is_eigen_v<typename std::decay_t<T>::value_type>;
-template <typename T>
-concept VarMatrix = EigenMatrix<typename std::decay_t<T>::value_type> && is_var_v<std::decay_t<T>>;
-template <typename... Types>
-concept AllVarMatrix = (VarMatrix<Types> && ...);
-
-
-template <typename T>
-concept MatrixVar = EigenMatrix<T> && is_var_v<typename std::decay_t<T>::Scalar>;
-template <typename... Types>
-concept AllMatrixVar = (MatrixVar<Types> && ...);
-
-template <typename T>
-concept PlainMatrix = EigenMatrix<T> && std::is_arithmetic_v<typename std::decay_t<T>::Scalar>;
-
-template <typename T>
-concept RevMatrix = MatrixVar<T> || VarMatrix<T>;
-template <PlainMatrix T>
-inline decltype(auto) value(T&& x) {
-  return x;
-}
-template <typename T1, typename T2>
-inline auto multiply(T1&& lhs, T2&& rhs) {
-  return make_var((value(lhs) * value(rhs)).eval(), [lhs, rhs](auto&& ret) mutable {
-      lhs.adj().array() += (ret.adj() * rhs.val().transpose()).array();
-      rhs.adj().array() += (ret.adj() * lhs.val().transpose()).array();
-  });
-}
-template <typename T>
-inline auto sum(T&& x) {
-  return make_var(x.val().sum(), [x](auto&& ret) mutable {
-    x.adj().array() += ret.adj();
-  });
-}
-
-}
 static void lambda_var_eigen(benchmark::State& state) {
 
   using mat_d = Eigen::Matrix<double, -1, -1>;
@@ -84,6 +27,7 @@ static void lambda_var_eigen(benchmark::State& state) {
   auto X1_d = mat_d::Random(N, N);
   auto X2_d = mat_d::Random(N, N);
   for (auto _ : state) {
+    ad::clear_mem();
     v_mat X1(X1_d);
     v_mat X2(X2_d);
     ad::var ret = ad::sum(ad::multiply(X1, X2));
@@ -91,8 +35,192 @@ static void lambda_var_eigen(benchmark::State& state) {
     benchmark::DoNotOptimize(ret);
     benchmark::DoNotOptimize(X1);
     benchmark::DoNotOptimize(X2);
-    ad::clear_mem();
   }
+  ad::report_tape_stats(state);
+  ad::report_profile(state);
+  ad::clear_mem();
 }
 BENCHMARK(lambda_var_eigen)-> RangeMultiplier(2) -> Range(1, 4096);
 
+// The model of expr_template_model in expr_template.cpp on var<Matrix>, at
+// the same sizes:
+//   sum(select(mask, exp(0.1 * (A * B)) .* log(C) + D, square(E') - F))
+// var<Matrix> has no select or transpose. The select is written as
+// M .* left + (1 - M) .* right with the mask as a 0/1 var matrix M, and E is
+// used untransposed, the inputs being random anyway.
+static void lambda_var_eigen_model(benchmark::State& state) {
+  using mat_d = Eigen::Matrix<double, -1, -1>;
+  using v_mat = ad::var_impl<mat_d>;
+  const auto N = state.range(0);
+  const mat_d A0 = mat_d::Random(N, N);
+  const mat_d B0 = mat_d::Random(N, N);
+  const mat_d C0 = mat_d::Random(N, N).array().abs() + 1.0;
+  const mat_d D0 = mat_d::Random(N, N);
+  const mat_d E0 = mat_d::Random(N, N);
+  const mat_d F0 = mat_d::Random(N, N);
+  const mat_d M0 = (A0.array() > 0.0).cast<double>();
+  for (auto _ : state) {
+    ad::clear_mem();
+    v_mat A(A0);
+    v_mat B(B0);
+    v_mat C(C0);
+    v_mat D(D0);
+    v_mat E(E0);
+    v_mat F(F0);
+    v_mat M(M0);
+    v_mat left = ad::elt_multiply(ad::exp(ad::elt_multiply(0.1, ad::multiply(A, B))),
+                                  ad::log(C))
+                 + D;
+    v_mat right = ad::elt_multiply(E, E) - F;
+    ad::var ret = ad::sum(ad::elt_multiply(M, left)
+                          + ad::elt_multiply(1.0 - M, right));
+    ad::grad(ret);
+    benchmark::DoNotOptimize(ret);
+    benchmark::DoNotOptimize(A);
+  }
+  ad::report_tape_stats(state);
+  ad::report_profile(state);
+  ad::clear_mem();
+}
+BENCHMARK(lambda_var_eigen_model)-> RangeMultiplier(2) -> Range(1, 1024);
+
+namespace {
+using mat_d = Eigen::Matrix<double, -1, -1>;
+using mat_v = Eigen::Matrix<ad::var, -1, -1>;
+
+// One functor per elementwise op. `apply()` is called with scalar vars for
+// the Matrix<var> version and with a var<Matrix> for the other.
+struct exp_op {
+  static auto apply(const auto& x) { return ad::exp(x); }
+};
+struct log_op {
+  static auto apply(const auto& x) { return ad::log(x); }
+};
+struct log1p_op {
+  static auto apply(const auto& x) { return ad::log1p(x); }
+};
+struct pow_op {
+  static auto apply(const auto& x) { return ad::pow(x, 2.5); }
+};
+struct sqrt_op {
+  static auto apply(const auto& x) { return ad::sqrt(x); }
+};
+struct lgamma_op {
+  static auto apply(const auto& x) { return ad::lgamma(x); }
+};
+struct inv_logit_op {
+  static auto apply(const auto& x) { return ad::inv_logit(x); }
+};
+struct softplus_op {
+  static auto apply(const auto& x) { return ad::softplus(x); }
+};
+struct add_op {
+  static auto apply(const auto& x, const auto& y) { return x + y; }
+};
+struct subtract_op {
+  static auto apply(const auto& x, const auto& y) { return x - y; }
+};
+struct elt_multiply_op {
+  template <typename T>
+  static auto apply(const T& x, const T& y) {
+    if constexpr (ad::Var<T>) {
+      return x * y;
+    } else {
+      return ad::elt_multiply(x, y);
+    }
+  }
+};
+struct elt_divide_op {
+  template <typename T>
+  static auto apply(const T& x, const T& y) {
+    if constexpr (ad::Var<T>) {
+      return x / y;
+    } else {
+      return ad::elt_divide(x, y);
+    }
+  }
+};
+
+template <typename Op>
+inline constexpr bool is_binary_op = requires(ad::var x) { Op::apply(x, x); };
+
+// Inputs in [1, 3] so every op is defined and away from its poles.
+inline mat_d positive_random(Eigen::Index N) {
+  return (mat_d::Random(N, N).array() + 2.0).matrix();
+}
+}  // namespace
+
+/**
+ * Elementwise op on a `Matrix<var>`: one node per coefficient.
+ */
+template <typename Op>
+static void lambda_matrix_var_op(benchmark::State& state) {
+  const auto N = state.range(0);
+  const mat_d X_d = positive_random(N);
+  const mat_d Y_d = positive_random(N);
+  for (auto _ : state) {
+    ad::clear_mem();
+    mat_v X(X_d);
+    ad::var ret;
+    if constexpr (is_binary_op<Op>) {
+      mat_v Y(Y_d);
+      ret = X.binaryExpr(Y, [](const ad::var& x, const ad::var& y) {
+        return Op::apply(x, y);
+      }).sum();
+    } else {
+      ret = X.unaryExpr([](const ad::var& x) { return Op::apply(x); }).sum();
+    }
+    ad::grad(ret);
+    benchmark::DoNotOptimize(ret);
+    benchmark::DoNotOptimize(X);
+  }
+  ad::report_tape_stats(state);
+  ad::report_profile(state);
+  ad::clear_mem();
+}
+
+/**
+ * The same op on a `var<Matrix>`: one node whose forward and reverse pass
+ * are single Eigen array expressions.
+ */
+template <typename Op>
+static void lambda_var_matrix_op(benchmark::State& state) {
+  using v_mat = ad::var_impl<mat_d>;
+  const auto N = state.range(0);
+  const mat_d X_d = positive_random(N);
+  const mat_d Y_d = positive_random(N);
+  for (auto _ : state) {
+    ad::clear_mem();
+    v_mat X(X_d);
+    ad::var ret;
+    if constexpr (is_binary_op<Op>) {
+      v_mat Y(Y_d);
+      ret = ad::sum(Op::apply(X, Y));
+    } else {
+      ret = ad::sum(Op::apply(X));
+    }
+    ad::grad(ret);
+    benchmark::DoNotOptimize(ret);
+    benchmark::DoNotOptimize(X);
+  }
+  ad::report_tape_stats(state);
+  ad::report_profile(state);
+  ad::clear_mem();
+}
+
+#define LAMBDA_VAR_EIGEN_OP(Op)                                               \
+  BENCHMARK(lambda_matrix_var_op<Op>)-> RangeMultiplier(4) -> Range(4, 4096); \
+  BENCHMARK(lambda_var_matrix_op<Op>)-> RangeMultiplier(4) -> Range(4, 4096);
+
+LAMBDA_VAR_EIGEN_OP(exp_op)
+LAMBDA_VAR_EIGEN_OP(log_op)
+LAMBDA_VAR_EIGEN_OP(log1p_op)
+LAMBDA_VAR_EIGEN_OP(pow_op)
+LAMBDA_VAR_EIGEN_OP(sqrt_op)
+LAMBDA_VAR_EIGEN_OP(lgamma_op)
+LAMBDA_VAR_EIGEN_OP(inv_logit_op)
+LAMBDA_VAR_EIGEN_OP(softplus_op)
+LAMBDA_VAR_EIGEN_OP(add_op)
+LAMBDA_VAR_EIGEN_OP(subtract_op)
+LAMBDA_VAR_EIGEN_OP(elt_multiply_op)
+LAMBDA_VAR_EIGEN_OP(elt_divide_op)
@@ -0,0 +1,141 @@
+#include <stdint.h>
+
+#include <benchmark/benchmark.h>
+#include <ad_ex/meta/Eigen.hpp>
+#include <ad_ex/lambda.hpp>
+#include <ad_ex/eigen_numtraits.hpp>
+#include <ad_ex/arena_matrix.hpp>
+#include <ad_ex/var_matrix.hpp>
+#include <ad_ex/var_matrix_linalg.hpp>
+#include <ad_ex/profile.hpp>
+#include <ad_ex/tape_stats.hpp>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace {
+using mat_d = Eigen::Matrix<double, -1, -1>;
+using mat_v = Eigen::Matrix<ad::var, -1, -1>;
+using v_mat = ad::var_impl<mat_d>;
+
+// Well conditioned symmetric positive definite input.
+inline mat_d random_spd(Eigen::Index N) {
+  const mat_d X = mat_d::Random(N, N);
+  return X * X.transpose() + N * mat_d::Identity(N, N);
+}
+
+// Right hand side of the solves.
+constexpr Eigen::Index rhs_cols = 8;
+
+/**
+ * Cholesky factor of a `Matrix<var>` written out coefficient by coefficient,
+ * which is what `Matrix<var>` gets without a matrix node: one scalar node per
+ * multiply-add.
+ */
+inline mat_v scalar_cholesky(const mat_v& A) {
+  const auto N = A.rows();
+  mat_v L = mat_v::Constant(N, N, ad::var(0.0));
+  for (Eigen::Index j = 0; j < N; ++j) {
+    ad::var d = A(j, j);
+    for (Eigen::Index k = 0; k < j; ++k) {
+      d = d - L(j, k) * L(j, k);
+    }
+    L(j, j) = ad::sqrt(d);
+    for (Eigen::Index i = j + 1; i < N; ++i) {
+      ad::var s = A(i, j);
+      for (Eigen::Index k = 0; k < j; ++k) {
+        s = s - L(i, k) * L(j, k);
+      }
+      L(i, j) = s / L(j, j);
+    }
+  }
+  return L;
+}
+}  // namespace
+
+static void matrix_var_cholesky(benchmark::State& state) {
+  const auto N = state.range(0);
+  const mat_d A_d = random_spd(N);
+  for (auto _ : state) {
+    ad::clear_mem();
+    mat_v A(A_d);
+    ad::var ret = scalar_cholesky(A).sum();
+    ad::grad(ret);
+    benchmark::DoNotOptimize(ret);
+    benchmark::DoNotOptimize(A);
+  }
+  ad::report_tape_stats(state);
+  ad::report_profile(state);
+  ad::clear_mem();
+}
+BENCHMARK(matrix_var_cholesky)-> RangeMultiplier(2) -> Range(8, 256);
+
+namespace {
+// One functor per op, called with the SPD var matrix `A` and a dense var
+// matrix `B` of `rhs_cols` columns.
+struct cholesky_op {
+  static auto apply(v_mat A, v_mat) { return ad::sum(ad::cholesky_decompose(A)); }
+};
+struct mdivide_left_tri_op {
+  static auto apply(v_mat A, v_mat B) {
+    return ad::sum(ad::mdivide_left_tri<Eigen::Lower>(A, B));
+  }
+};
+struct mdivide_left_op {
+  static auto apply(v_mat A, v_mat B) { return ad::sum(ad::mdivide_left(A, B)); }
+};
+struct log_determinant_op {
+  static auto apply(v_mat A, v_mat) { return ad::log_determinant(A); }
+};
+struct log_determinant_spd_op {
+  static auto apply(v_mat A, v_mat) { return ad::log_determinant_spd(A); }
+};
+struct inverse_op {
+  static auto apply(v_mat A, v_mat) { return ad::sum(ad::inverse(A)); }
+};
+/**
+ * Multivariate normal log density of the columns of `B` with covariance `A`
+ * and mean zero, up to a constant.
+ */
+struct multi_normal_op {
+  static auto apply(v_mat A, v_mat B) {
+    v_mat z = ad::mdivide_left_tri<Eigen::Lower>(ad::cholesky_decompose(A), B);
+    return -0.5 * ad::sum(ad::elt_multiply(z, z))
+           - 0.5 * static_cast<double>(rhs_cols) * ad::log_determinant_spd(A);
+  }
+};
+}  // namespace
+
+/**
+ * The op on `var<Matrix>`: one node for the factorization and its reverse
+ * pass.
+ */
+template <typename Op>
+static void var_matrix_linalg(benchmark::State& state) {
+  const auto N = state.range(0);
+  const mat_d A_d = random_spd(N);
+  const mat_d B_d = mat_d::Random(N, rhs_cols);
+  for (auto _ : state) {
+    ad::clear_mem();
+    v_mat A(A_d);
+    v_mat B(B_d);
+    ad::var ret = Op::apply(A, B);
+    ad::grad(ret);
+    benchmark::DoNotOptimize(ret);
+    benchmark::DoNotOptimize(A);
+  }
+  ad::report_tape_stats(state);
+  ad::report_profile(state);
+  ad::clear_mem();
+}
+
+#define VAR_MATRIX_LINALG(Op) \
+  BENCHMARK(var_matrix_linalg<Op>)-> RangeMultiplier(2) -> Range(8, 512);
+
+VAR_MATRIX_LINALG(cholesky_op)
+VAR_MATRIX_LINALG(mdivide_left_tri_op)
+VAR_MATRIX_LINALG(mdivide_left_op)
+VAR_MATRIX_LINALG(log_determinant_op)
+VAR_MATRIX_LINALG(log_determinant_spd_op)
+VAR_MATRIX_LINALG(inverse_op)
+VAR_MATRIX_LINALG(multi_normal_op)
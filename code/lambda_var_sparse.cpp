@@ -0,0 +1,155 @@
+#include <stdint.h>
+
+#include <benchmark/benchmark.h>
+#include <ad_ex/meta/Eigen.hpp>
+#include <ad_ex/lambda.hpp>
+#include <ad_ex/eigen_numtraits.hpp>
+#include <ad_ex/arena_matrix.hpp>
+#include <ad_ex/var_matrix.hpp>
+#include <ad_ex/var_sparse.hpp>
+#include <ad_ex/profile.hpp>
+#include <ad_ex/tape_stats.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+// Sparse products against the same products with the sparse matrix densified,
+// the way sparse design matrices are handled without var_sparse.hpp. The first
+// argument is the size N, the second the density in parts per thousand, so
+// 1, 10 and 100 are 0.1%, 1% and 10% nonzeros.
+
+namespace {
+using mat_d = Eigen::Matrix<double, -1, -1>;
+using vec_d = Eigen::Matrix<double, -1, 1>;
+using sparse_d = Eigen::SparseMatrix<double>;
+
+// Columns of the dense right hand side in the sparse var benchmarks.
+constexpr Eigen::Index rhs_cols = 8;
+
+inline sparse_d random_sparse(Eigen::Index N, std::int64_t per_mille) {
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<Eigen::Index> index(0, N - 1);
+  std::uniform_real_distribution<double> coeff(-1.0, 1.0);
+  const auto nnz = std::max<Eigen::Index>(1, N * N * per_mille / 1000);
+  std::vector<Eigen::Triplet<double>> triplets;
+  triplets.reserve(nnz);
+  for (Eigen::Index i = 0; i < nnz; ++i) {
+    triplets.emplace_back(index(rng), index(rng), coeff(rng));
+  }
+  sparse_d ret(N, N);
+  ret.setFromTriplets(triplets.begin(), triplets.end());
+  return ret;
+}
+
+inline void report_density(benchmark::State& state, const sparse_d& X) {
+  state.counters["nnz"] = X.nonZeros();
+}
+}  // namespace
+
+/**
+ * Sparse data times a var vector, as in a regression with a sparse design
+ * matrix.
+ */
+static void sparse_data_var_vector(benchmark::State& state) {
+  using v_vec = ad::var_impl<vec_d>;
+  const auto N = state.range(0);
+  const sparse_d X = random_sparse(N, state.range(1));
+  const vec_d beta_d = vec_d::Random(N);
+  for (auto _ : state) {
+    ad::clear_mem();
+    v_vec beta(beta_d);
+    ad::var ret = ad::sum(ad::multiply(X, beta));
+    ad::grad(ret);
+    benchmark::DoNotOptimize(ret);
+    benchmark::DoNotOptimize(beta);
+  }
+  report_density(state, X);
+  ad::report_tape_stats(state);
+  ad::report_profile(state);
+  ad::clear_mem();
+}
+
+/**
+ * The same product with the design matrix densified. It is still data, so as
+ * in the sparse case only `beta` gets an adjoint.
+ */
+static void dense_data_var_vector(benchmark::State& state) {
+  using v_vec = ad::var_impl<vec_d>;
+  const auto N = state.range(0);
+  const sparse_d X_s = random_sparse(N, state.range(1));
+  const mat_d X(X_s);
+  const vec_d beta_d = vec_d::Random(N);
+  for (auto _ : state) {
+    ad::clear_mem();
+    v_vec beta(beta_d);
+    ad::var ret = ad::sum(ad::multiply(X, beta));
+    ad::grad(ret);
+    benchmark::DoNotOptimize(ret);
+    benchmark::DoNotOptimize(beta);
+  }
+  report_density(state, X_s);
+  ad::report_tape_stats(state);
+  ad::report_profile(state);
+  ad::clear_mem();
+}
+
+/**
+ * A sparse var matrix times a dense var matrix. Only the nonzeros of the
+ * sparse side get adjoints.
+ */
+static void sparse_var_dense_var(benchmark::State& state) {
+  using v_mat = ad::var_impl<mat_d>;
+  using v_sparse = ad::var_impl<sparse_d>;
+  const auto N = state.range(0);
+  const sparse_d X_d = random_sparse(N, state.range(1));
+  const mat_d B_d = mat_d::Random(N, rhs_cols);
+  for (auto _ : state) {
+    ad::clear_mem();
+    v_sparse X(X_d);
+    v_mat B(B_d);
+    ad::var ret = ad::sum(ad::multiply(X, B));
+    ad::grad(ret);
+    benchmark::DoNotOptimize(ret);
+    benchmark::DoNotOptimize(X);
+  }
+  report_density(state, X_d);
+  ad::report_tape_stats(state);
+  ad::report_profile(state);
+  ad::clear_mem();
+}
+
+/**
+ * The same product with the sparse side densified, which gives every zero an
+ * adjoint as well.
+ */
+static void dense_var_dense_var(benchmark::State& state) {
+  using v_mat = ad::var_impl<mat_d>;
+  const auto N = state.range(0);
+  const sparse_d X_s = random_sparse(N, state.range(1));
+  const mat_d X_d(X_s);
+  const mat_d B_d = mat_d::Random(N, rhs_cols);
+  for (auto _ : state) {
+    ad::clear_mem();
+    v_mat X(X_d);
+    v_mat B(B_d);
+    ad::var ret = ad::sum(ad::multiply(X, B));
+    ad::grad(ret);
+    benchmark::DoNotOptimize(ret);
+    benchmark::DoNotOptimize(X);
+  }
+  report_density(state, X_s);
+  ad::report_tape_stats(state);
+  ad::report_profile(state);
+  ad::clear_mem();
+}
+
+#define LAMBDA_VAR_SPARSE_BENCH(bench)                                 \
+  BENCHMARK(bench)->ArgNames({"N", "per_mille"})->ArgsProduct(         \
+      {{256, 1024, 2048}, {1, 10, 100}});
+
+LAMBDA_VAR_SPARSE_BENCH(sparse_data_var_vector)
+LAMBDA_VAR_SPARSE_BENCH(dense_data_var_vector)
+LAMBDA_VAR_SPARSE_BENCH(sparse_var_dense_var)
+LAMBDA_VAR_SPARSE_BENCH(dense_var_dense_var)
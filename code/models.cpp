@@ -0,0 +1,152 @@
+#include <ad_ex/backends.hpp>
+#include <ad_ex/models.hpp>
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <unistd.h>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Every model of models.hpp on every backend of backends.hpp, over a range
+// of data sizes. After the usual output a table compares each backend to the
+// hand written gradient of the same model and size.
+
+using namespace ad::models;
+
+template <typename M, template <typename> typename Backend>
+static void model_bench(benchmark::State& state) {
+  const M m(state.range(0));
+  const auto x = m.initial();
+  std::vector<double> g(m.dims());
+  std::vector<double> g_ref(m.dims());
+  const double lp_ref = m.gradient(x, g_ref);
+  Backend<M> b(m);
+  double lp = 0;
+  // lp is passed as const so DoNotOptimize only reads it. Given the non-const
+  // lp, benchmark 1.7's "+m,r" read-write operand lets GCC 12 at -O3 drop the
+  // store of the soa_replay value before the asm, and rel_err reads garbage.
+  for (auto _ : state) {
+    lp = b.gradient(x, g);
+    benchmark::DoNotOptimize(std::as_const(lp));
+    benchmark::DoNotOptimize(g.data());
+  }
+  // Largest error relative to the hand written gradient.
+  double err = std::abs(lp - lp_ref) / std::max(1.0, std::abs(lp_ref));
+  for (std::size_t i = 0; i < g.size(); ++i) {
+    err = std::max(err, std::abs(g[i] - g_ref[i]) / std::max(1.0, std::abs(g_ref[i])));
+  }
+  state.counters["dims"] = m.dims();
+  state.counters["rel_err"] = err;
+}
+
+template <typename M, template <typename> typename... Backends>
+static void register_backends(int lo, int hi, int mult) {
+  (benchmark::RegisterBenchmark(
+       (std::string(M::name) + "/" + std::string(Backends<M>::name)).c_str(),
+       model_bench<M, Backends>)
+       ->RangeMultiplier(mult)
+       ->Range(lo, hi)
+       ->Unit(benchmark::kMicrosecond),
+   ...);
+}
+
+template <typename M>
+static void register_model(int lo, int hi, int mult) {
+  register_backends<M, baseline_backend, lambda_backend, soa_backend,
+                 soa_replay_backend, fvar_backend>(lo, hi, mult);
+}
+
+/**
+ * Console output as usual, followed by one row per model and size with the
+ * time of each backend and its ratio to the baseline.
+ */
+class comparison_reporter : public benchmark::ConsoleReporter {
+ public:
+  comparison_reporter()
+      : ConsoleReporter(isatty(fileno(stdout)) ? OO_Defaults : OO_Tabular) {}
+
+  void ReportRuns(const std::vector<Run>& runs) override {
+    ConsoleReporter::ReportRuns(runs);
+    for (auto&& run : runs) {
+      // Keep the median when there are repetitions.
+      const bool median = run.run_type == Run::RT_Aggregate;
+      if (median && run.aggregate_name != "median") {
+        continue;
+      }
+      const auto& name = run.run_name.function_name;
+      const auto slash = name.find('/');
+      const std::string row = name.substr(0, slash) + "/" + run.run_name.args;
+      const std::string col = name.substr(slash + 1);
+      if (median || !medians_.count({row, col})) {
+        times_[row][col] = run.GetAdjustedRealTime();
+        if (median) {
+          medians_.insert({row, col});
+        }
+      }
+      if (std::find(cols_.begin(), cols_.end(), col) == cols_.end()) {
+        cols_.push_back(col);
+      }
+      if (std::find(rows_.begin(), rows_.end(), row) == rows_.end()) {
+        rows_.push_back(row);
+      }
+    }
+  }
+
+  void Finalize() override {
+    ConsoleReporter::Finalize();
+    auto& out = GetOutputStream();
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "\n%-28s", "us (x baseline)");
+    out << buf;
+    for (auto&& col : cols_) {
+      std::snprintf(buf, sizeof(buf), "%20s", col.c_str());
+      out << buf;
+    }
+    out << "\n";
+    for (auto&& row : rows_) {
+      std::snprintf(buf, sizeof(buf), "%-28s", row.c_str());
+      out << buf;
+      const auto& times = times_[row];
+      const auto base = times.find("baseline");
+      for (auto&& col : cols_) {
+        const auto t = times.find(col);
+        if (t == times.end()) {
+          std::snprintf(buf, sizeof(buf), "%20s", "-");
+        } else if (base == times.end()) {
+          std::snprintf(buf, sizeof(buf), "%20.2f", t->second);
+        } else {
+          std::snprintf(buf, sizeof(buf), "%11.2f (%5.1fx)", t->second,
+                        t->second / base->second);
+        }
+        out << buf;
+      }
+      out << "\n";
+    }
+  }
+
+ private:
+  std::vector<std::string> rows_;
+  std::vector<std::string> cols_;
+  std::map<std::string, std::map<std::string, double>> times_;
+  std::set<std::pair<std::string, std::string>> medians_;
+};
+
+int main(int argc, char** argv) {
+  register_model<logistic_regression>(16, 4096, 4);
+  register_model<hierarchical_normal>(8, 2048, 4);
+  register_model<gp_marginal>(8, 64, 2);
+  register_model<mlp>(16, 1024, 4);
+  register_model<rk4_ode>(16, 1024, 4);
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  comparison_reporter reporter;
+  benchmark::RunSpecifiedBenchmarks(&reporter);
+  benchmark::Shutdown();
+  return 0;
+}
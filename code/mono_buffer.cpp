@@ -11,9 +11,15 @@
 #include <memory>
 #include <memory_resource>
 #include <ranges> // For std::views::reverse
+#include <cstdlib>
+#include <cxxabi.h>
+#include <map>
+#include <string>
+#include <typeinfo>
 #include <benchmark/benchmark.h>
+#include <ad_ex/arena.hpp>
 
-static std::pmr::monotonic_buffer_resource mbr{1<<16};
+static ad::arena_resource mbr{1<<16};
 using alloc_t = std::pmr::polymorphic_allocator<std::byte>;
 static alloc_t pa{&mbr};
 struct var_impl {
@@ -187,17 +193,95 @@ void grad(var z) noexcept {
 }
 void clear_mem() {
     var_vec.clear();
-    mbr.release();
+    mbr.recover();
+}
+
+// Tape statistics as benchmark counters, taken while the tape still holds
+// the last gradient. See ad_ex/tape_stats.hpp for the ad::tape version.
+static void report_tape_stats(benchmark::State& state) {
+    std::map<std::string, std::size_t> by_type;
+    for (auto* x : var_vec) {
+      int status = 0;
+      char* name = abi::__cxa_demangle(typeid(*x).name(), nullptr, nullptr, &status);
+      ++by_type[status == 0 ? name : typeid(*x).name()];
+      std::free(name);
+    }
+    state.counters["nodes"] = var_vec.size();
+    state.counters["var_vec_capacity"] = var_vec.capacity();
+    state.counters["arena_bytes"] = mbr.bytes_used();
+    state.counters["peak_bytes"] = mbr.peak_bytes();
+    state.counters["upstream_allocs"] = mbr.upstream_allocations();
+    for (auto&& [name, count] : by_type) {
+      state.counters["n:" + name] = count;
+    }
 }
 
 static void monobuff_bench(benchmark::State& state) {
     for (auto _ : state) {
+      clear_mem();
       var x(2.0);
       var y(4.0);
       auto z = x * log(y) + log(x * y) * y;
       grad(z);
       benchmark::DoNotOptimize(z);
-      clear_mem();
     }
+    report_tape_stats(state);
+    clear_mem();
 }
 BENCHMARK(monobuff_bench);
+
+static void monobuff_tape_size_bench(benchmark::State& state) {
+    const auto N = state.range(0);
+    for (auto _ : state) {
+      clear_mem();
+      var x(2.0);
+      var y(4.0);
+      var z(0.0);
+      for (int i = 0; i < N; ++i) {
+        z += x * log(y) + log(x * y) * y;
+      }
+      grad(z);
+      benchmark::DoNotOptimize(z);
+    }
+    report_tape_stats(state);
+    clear_mem();
+    state.SetItemsProcessed(state.iterations() * N);
+}
+BENCHMARK(monobuff_tape_size_bench)-> RangeMultiplier(4) -> Range(1, 1 << 16);
+
+static void monobuff_graph_bench(benchmark::State& state) {
+    const auto reps = state.range(0) / 7;
+    for (auto _ : state) {
+      clear_mem();
+      var x(2.0);
+      var y(4.0);
+      var z(0.0);
+      for (int i = 0; i < reps; ++i) {
+        z += x * log(y) + log(x * y) * y;
+      }
+      grad(z);
+      benchmark::DoNotOptimize(z);
+    }
+    report_tape_stats(state);
+    clear_mem();
+    state.SetItemsProcessed(state.iterations() * reps * 7);
+}
+BENCHMARK(monobuff_graph_bench)-> RangeMultiplier(10) -> Range(1000, 10000000);
+
+// An aligned request whose padding alone runs past the end of an odd sized
+// buffer has to move on to a new chunk rather than hand out memory past it.
+static void arena_odd_buffer_bench(benchmark::State& state) {
+    alignas(64) std::byte buffer[100];
+    for (auto _ : state) {
+      ad::arena_resource arena(buffer, sizeof(buffer));
+      arena.allocate(90, 8);
+      auto* p = static_cast<std::byte*>(arena.allocate(8, 64));
+      if ((p >= buffer && p < buffer + sizeof(buffer))
+          || arena.upstream_allocations() != 1) {
+        state.SkipWithError("aligned allocation ran past the arena buffer");
+        break;
+      }
+      benchmark::DoNotOptimize(p);
+    }
+}
+BENCHMARK(arena_odd_buffer_bench);
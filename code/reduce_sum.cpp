@@ -0,0 +1,77 @@
+#include <stdint.h>
+
+#include <benchmark/benchmark.h>
+#include <ad_ex/lambda.hpp>
+#include <ad_ex/reduce_sum.hpp>
+#include <ad_ex/profile.hpp>
+#include <ad_ex/tape_stats.hpp>
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <span>
+#include <vector>
+
+// Normal log-likelihood of a slice, dropping the constant.
+static ad::var normal_lpdf(std::span<const double> y, ad::var mu,
+                           ad::var sigma) {
+  ad::var inv_sigma = 1.0 / sigma;
+  ad::var lp = -static_cast<double>(y.size()) * log(sigma);
+  for (auto y_i : y) {
+    lp += -0.5 * square((y_i - mu) * inv_sigma);
+  }
+  return lp;
+}
+
+static std::vector<double> normal_data(std::size_t n) {
+  std::mt19937 rng(1234);
+  std::normal_distribution<double> dist(1.0, 2.0);
+  std::vector<double> y(n);
+  for (auto& y_i : y) {
+    y_i = dist(rng);
+  }
+  return y;
+}
+
+// Everything on one tape on the calling thread.
+static void normal_lpdf_serial_bench(benchmark::State& state) {
+    const auto y = normal_data(state.range(0));
+    for (auto _ : state) {
+      ad::clear_mem();
+      ad::var mu(0.5);
+      ad::var sigma(1.5);
+      ad::var lp = normal_lpdf(y, mu, sigma);
+      ad::grad(lp);
+      benchmark::DoNotOptimize(mu.adj());
+      benchmark::DoNotOptimize(sigma.adj());
+    }
+    ad::report_tape_stats(state);
+    ad::report_profile(state);
+    ad::clear_mem();
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(normal_lpdf_serial_bench)-> RangeMultiplier(10) -> Range(100000, 10000000)
+    -> Unit(benchmark::kMillisecond);
+
+// Args are the number of terms and the number of threads, including the
+// calling thread. Slices are 4096 terms.
+static void normal_lpdf_reduce_sum_bench(benchmark::State& state) {
+    const auto y = normal_data(state.range(0));
+    ad::thread_pool pool(state.range(1));
+    for (auto _ : state) {
+      ad::clear_mem();
+      ad::var mu(0.5);
+      ad::var sigma(1.5);
+      ad::var lp = ad::reduce_sum(pool, normal_lpdf, y, 4096, mu, sigma);
+      ad::grad(lp);
+      benchmark::DoNotOptimize(mu.adj());
+      benchmark::DoNotOptimize(sigma.adj());
+    }
+    ad::report_tape_stats(state);
+    ad::report_profile(state);
+    ad::clear_mem();
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(normal_lpdf_reduce_sum_bench)
+    -> ArgNames({"n", "threads"})
+    -> ArgsProduct({{100000, 1000000, 10000000}, {1, 2, 4, 8, 16}})
+    -> UseRealTime() -> Unit(benchmark::kMillisecond);
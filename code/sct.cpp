@@ -1,6 +1,8 @@
 // Type your code here, or load an example.
 #include <stdint.h>
 
+#include <Eigen/Dense>
+#include <array>
 #include <cmath>
 #include <cstddef>
 #include <cstdlib>
@@ -21,6 +23,7 @@
 struct var {
     double values_;
     double adjoints_;
+    var() : values_(0), adjoints_(0) {}
     var(double x) : values_(x), adjoints_(0) {}
     auto val() const {
       return values_;
@@ -29,6 +32,31 @@ struct var {
       return adjoints_;
     }
 };
+namespace Eigen {
+// Lets fixed size Eigen vectors hold vars. They are only used as storage
+// for inputs, the arithmetic is done by the reductions below.
+template <>
+struct NumTraits<var> : GenericNumTraits<var> {
+  using Real = double;
+  using NonInteger = var;
+  using Nested = var;
+  using Literal = var;
+  static inline Real dummy_precision() { return NumTraits<double>::dummy_precision(); }
+  static inline Real epsilon() { return NumTraits<double>::epsilon(); }
+  static inline Real highest() { return NumTraits<double>::highest(); }
+  static inline Real lowest() { return NumTraits<double>::lowest(); }
+  enum {
+    IsComplex = 0,
+    IsInteger = 0,
+    IsSigned = 1,
+    RequireInitialization = 1,
+    ReadCost = 1,
+    AddCost = 2,
+    MulCost = 2
+  };
+};
+}  // namespace Eigen
+
 // If you already have is_var_v, keep that and skip this block.
 template <typename T>
 inline constexpr bool is_var_v =
@@ -143,7 +171,11 @@ constexpr void print_var(const char* name, var& ret, var x, var y) {}
 template <typename... Types>
 concept any_var_or_expr = ((Var<Types> || Expr<Types>) || ... || (false));
 
-template <typename T1, typename T2>
+// Every function that builds a node takes a defaulted `Id` template parameter.
+// The closure type of its default is new at each call, so each call uses a
+// different specialization and the node it returns has a type of its own. The
+// type then stands for the node when the graph is flattened, see post_order().
+template <typename T1, typename T2, typename Id = decltype([] {})>
 requires any_var_or_expr<T1, T2>
 inline auto operator+(T1&& lhs, T2&& rhs) {
   return make_expr(value(lhs) + value(rhs), [](auto&& ret, auto&& lhs, auto&& rhs) {
@@ -156,7 +188,7 @@ inline auto operator+(T1&& lhs, T2&& rhs) {
   }, std::forward<T1>(lhs), std::forward<T2>(rhs));
 }
 
-template <typename T1, typename T2>
+template <typename T1, typename T2, typename Id = decltype([] {})>
 requires any_var_or_expr<T1, T2>
 inline auto operator*(T1&& lhs, T2&& rhs) {
   return make_expr(value(lhs) * value(rhs), [](auto&& ret, auto&& lhs, auto&& rhs) {
@@ -169,75 +201,247 @@ inline auto operator*(T1&& lhs, T2&& rhs) {
   }, std::forward<T1>(lhs), std::forward<T2>(rhs));
 }
 
-template <typename Expr>
+template <typename Expr, typename Id = decltype([] {})>
 inline auto log(Expr&& x) {
   return make_expr(std::log(x.val()), [](auto&& ret, auto&& x) {
     adjoint(x) += ret.adj() / value(x);
   }, std::forward<Expr>(x));
 }
 
-// Wrap an object in a tuple if it's an ad_expr, otherwise an empty tuple.
+/**
+ * Fixed size vectors: `std::array<T, N>` and `Eigen::Matrix<T, N, 1>`.
+ */
+namespace detail {
+  template <typename T>
+  struct fixed_vector : std::false_type {};
+  template <typename T, std::size_t N>
+  struct fixed_vector<std::array<T, N>> : std::true_type {
+    using value_type = T;
+    static constexpr std::size_t size = N;
+  };
+  template <typename T, int N, int Options, int MaxN>
+  requires(N != Eigen::Dynamic)
+  struct fixed_vector<Eigen::Matrix<T, N, 1, Options, MaxN, 1>> : std::true_type {
+    using value_type = T;
+    static constexpr std::size_t size = N;
+  };
+}
+template <typename T>
+using fixed_vector = detail::fixed_vector<std::remove_cvref_t<T>>;
+
+template <typename T>
+concept FixedVector = fixed_vector<T>::value;
+
+template <typename T>
+concept FixedVarVector = FixedVector<T> && Var<typename fixed_vector<T>::value_type>;
+
 template <typename T>
-constexpr auto make_expr_tuple(T&& x) {
-  if constexpr (is_ref_wrap_expr_v<std::decay_t<T>>) {
-    return std::tuple{x};
-  } else if constexpr (is_expr_v<std::decay_t<T>>) {
-    return std::tuple<std::reference_wrapper<std::decay_t<T>>>{std::ref(x)};
+concept FixedDoubleVector
+    = FixedVector<T> && std::is_arithmetic_v<typename fixed_vector<T>::value_type>;
+
+/**
+ * Reductions over fixed size vectors of vars. Every element is its own child
+ * of the node, held by reference, so the reverse functor is a fold over the
+ * elements that unrolls completely. Nothing is allocated.
+ */
+template <FixedVarVector X, typename Id = decltype([] {})>
+inline auto sum(X& x) {
+  return [&]<std::size_t... I>(std::index_sequence<I...>) {
+    return make_expr((0.0 + ... + value(x[I])), [](auto&& ret, auto&&... xs) {
+      ((adjoint(xs) += adjoint(ret)), ...);
+    }, x[I]...);
+  }(std::make_index_sequence<fixed_vector<X>::size>{});
+}
+
+template <FixedVarVector X, FixedVarVector Y, typename Id = decltype([] {})>
+requires(fixed_vector<X>::size == fixed_vector<Y>::size)
+inline auto dot(X& x, Y& y) {
+  return [&]<std::size_t... I>(std::index_sequence<I...>) {
+    return make_expr((0.0 + ... + (value(x[I]) * value(y[I]))), [](auto&& ret, auto&&... xy) {
+      // The first half of the children are x, the second half y.
+      auto args = std::forward_as_tuple(xy...);
+      constexpr std::size_t n = sizeof...(xy) / 2;
+      [&]<std::size_t... J>(std::index_sequence<J...>) {
+        ((adjoint(std::get<J>(args)) += adjoint(ret) * value(std::get<n + J>(args)),
+          adjoint(std::get<n + J>(args)) += adjoint(ret) * value(std::get<J>(args))),
+         ...);
+      }(std::make_index_sequence<n>{});
+    }, x[I]..., y[I]...);
+  }(std::make_index_sequence<fixed_vector<X>::size>{});
+}
+
+// Dot product with constant data, which is copied into the functor.
+template <FixedVarVector X, FixedDoubleVector Y, typename Id = decltype([] {})>
+requires(fixed_vector<X>::size == fixed_vector<Y>::size)
+inline auto dot(X& x, const Y& y) {
+  constexpr std::size_t N = fixed_vector<X>::size;
+  std::array<double, N> data;
+  for (std::size_t i = 0; i < N; ++i) {
+    data[i] = y[i];
+  }
+  return [&]<std::size_t... I>(std::index_sequence<I...>) {
+    return make_expr((0.0 + ... + (value(x[I]) * data[I])),
+      [data](auto&& ret, auto&&... xs) {
+        std::size_t i = 0;
+        ((adjoint(xs) += adjoint(ret) * data[i++]), ...);
+      }, x[I]...);
+  }(std::make_index_sequence<N>{});
+}
+
+template <FixedVarVector X, typename Id = decltype([] {})>
+inline auto norm(X& x) {
+  return [&]<std::size_t... I>(std::index_sequence<I...>) {
+    return make_expr(std::sqrt((0.0 + ... + (value(x[I]) * value(x[I])))),
+      [](auto&& ret, auto&&... xs) {
+        const double d = adjoint(ret) / value(ret);
+        ((adjoint(xs) += d * value(xs)), ...);
+      }, x[I]...);
+  }(std::make_index_sequence<fixed_vector<X>::size>{});
+}
+
+template <typename... Ts>
+struct type_list {};
+
+// A node of the graph, reached from the root by taking the child at each
+// position of `Path` in turn from `exprs_`. A `Shared` node is held by
+// reference and can have several parents, any other node has one.
+template <typename Node, bool Shared, std::size_t... Path>
+struct node_entry {
+  using node_type = Node;
+  static constexpr bool shared = Shared;
+};
+
+// A shared node reached again along `Path`, which should be `Entry`.
+template <typename Entry, std::size_t... Path>
+struct node_alias {};
+
+// The nodes of a graph in post-order and the paths that were not expanded.
+template <typename Nodes, typename Aliases>
+struct flat_graph {};
+
+template <typename Node, typename... Entries>
+constexpr bool seen_shared_v
+    = ((Entries::shared && std::is_same_v<typename Entries::node_type, Node>) || ... || false);
+
+// The entry of the shared node of type `Node`, once seen_shared_v says it is
+// there.
+template <typename Node, typename Entry, typename... Entries>
+constexpr auto first_shared(type_list<Entry, Entries...>) {
+  if constexpr (Entry::shared && std::is_same_v<typename Entry::node_type, Node>) {
+    return Entry{};
   } else {
-    return std::tuple<>();
+    return first_shared<Node>(type_list<Entries...>{});
   }
 }
 
-// Given an ad_expr node, return a tuple of its children that are ad_exprs.
-template <typename E>
-constexpr auto child_exprs(E&& e) {
-  static_assert(is_expr_v<std::decay_t<E>> || is_ref_wrap_v<std::decay_t<E>>,
-                "child_exprs expects an ad_expr node");
-  return std::apply(
-      [](auto&... args) {
-        return std::tuple_cat(make_expr_tuple(args)...);
-      },
-      std::forward<E>(e).exprs_);
+template <typename T>
+constexpr auto& unwrap(T& x) {
+  if constexpr (is_ref_wrap_v<T>) {
+    return x.get();
+  } else {
+    return x;
+  }
 }
 
-// Flatten the graph in BFS order: level, then its children, etc.
-template <typename Tuple>
-constexpr auto bfs_flatten(Tuple&& level) {
-  if constexpr (std::tuple_size_v<std::decay_t<Tuple>> == 0) {
-    return std::tuple<>();
+// The node at the end of the path `I, Path...` from `node`.
+template <std::size_t I, std::size_t... Path, typename Node>
+constexpr auto& node_at(Node& node) {
+  auto& child = unwrap(std::get<I>(node.exprs_));
+  if constexpr (sizeof...(Path) == 0) {
+    return child;
   } else {
-    auto next = std::apply(
-        [](auto&... nodes) { return std::tuple_cat(child_exprs(nodes.get())...); },
-        level);
-    return std::tuple_cat(std::forward<Tuple>(level), bfs_flatten(std::move(next)));
+    return node_at<Path...>(child);
   }
 }
+template <typename Root>
+constexpr auto& node_at(Root& root) {
+  return root;
+}
 
-// Entry point: collect nodes (ad_exprs) reachable from z in BFS order.
-template <typename Expr>
-constexpr auto collect_bfs(Expr&& z) {
-  if constexpr (is_expr_v<std::decay_t<Expr>>) {
-    return bfs_flatten(std::tuple{std::ref(std::forward<Expr>(z))});
+template <typename Node, bool Shared, std::size_t... Path, typename... Nodes,
+          typename... Aliases>
+constexpr auto post_order(node_entry<Node, Shared, Path...> entry,
+                          flat_graph<type_list<Nodes...>, type_list<Aliases...>> g);
+
+template <typename Node, std::size_t I, std::size_t... Path, typename Graph>
+constexpr auto post_order_children(std::index_sequence<Path...> path, Graph g) {
+  using exprs_t = decltype(Node::exprs_);
+  if constexpr (I == std::tuple_size_v<exprs_t>) {
+    return g;
   } else {
-    return std::tuple<>();
+    using child_t = std::tuple_element_t<I, exprs_t>;
+    if constexpr (is_ref_wrap_expr_v<child_t>) {
+      return post_order_children<Node, I + 1>(
+          path, post_order(node_entry<typename child_t::type, true, Path..., I>{}, g));
+    } else if constexpr (is_expr_v<child_t>) {
+      return post_order_children<Node, I + 1>(
+          path, post_order(node_entry<child_t, false, Path..., I>{}, g));
+    } else {
+      return post_order_children<Node, I + 1>(path, g);
+    }
   }
 }
 
-// Evaluate reverse-pass functors breadthwise using the collected tuple.
-template <typename Tuple>
-inline void eval_breadthwise(Tuple&& nodes) {
-  std::apply(
-      [](auto&... node_wrappers) {
-        // For each node in BFS order, apply its local reverse functor.
-        (std::apply(
-             [&](auto&... args) {
-               auto& node = node_wrappers.get();
-               compute_f(node, args...);  // propagates adjoint to children
-             },
-             node_wrappers.get().exprs_),
-         ...);
-      },
-      std::forward<Tuple>(nodes));
+template <typename Entry, typename... Nodes, typename... Aliases>
+constexpr auto append_node(flat_graph<type_list<Nodes...>, type_list<Aliases...>>) {
+  return flat_graph<type_list<Nodes..., Entry>, type_list<Aliases...>>{};
+}
+
+// Flatten the graph in post-order, every node after all of its children. This
+// is done on types alone: a node is named by its path from the root, so the
+// reverse pass reaches it through members and the whole gradient stays one
+// straight-line function.
+//
+// A shared node already in the list is not expanded again, so it appears once
+// and the list grows with the number of nodes, not of paths. Whether it is
+// already there is decided by its type, which is unique to the call that
+// built it. A call evaluated twice in one graph, e.g. from a helper function
+// called twice, builds two nodes of one type, so each path not expanded is
+// kept as an alias to check at run time. A node held by value has one parent
+// and is always expanded.
+template <typename Node, bool Shared, std::size_t... Path, typename... Nodes,
+          typename... Aliases>
+constexpr auto post_order(node_entry<Node, Shared, Path...> entry,
+                          flat_graph<type_list<Nodes...>, type_list<Aliases...>> g) {
+  if constexpr (Shared && seen_shared_v<Node, Nodes...>) {
+    using first_t = decltype(first_shared<Node>(type_list<Nodes...>{}));
+    return flat_graph<type_list<Nodes...>,
+                      type_list<Aliases..., node_alias<first_t, Path...>>>{};
+  } else {
+    return append_node<decltype(entry)>(
+        post_order_children<Node, 0>(std::index_sequence<Path...>{}, g));
+  }
+}
+
+template <typename Root, typename Node, bool Shared, std::size_t... Path,
+          std::size_t... AliasPath>
+inline void check_alias(Root& root,
+                        node_alias<node_entry<Node, Shared, Path...>, AliasPath...>) {
+  if (&node_at<Path...>(root) != &node_at<AliasPath...>(root)) {
+    throw std::logic_error("grad: two subexpressions of the same type, "
+                           "built by one call evaluated twice");
+  }
+}
+
+template <typename Root, typename Node, bool Shared, std::size_t... Path>
+inline void eval_node(Root& root, node_entry<Node, Shared, Path...>) {
+  auto& node = node_at<Path...>(root);
+  std::apply([&](auto&... args) { compute_f(node, args...); }, node.exprs_);
+}
+
+// Evaluate reverse-pass functors in reverse post-order. This is a reverse
+// topological order, so a node's functor runs once, after all of its parents
+// added to its adjoint. The aliases are checked first. The addresses are
+// known once grad() is inlined, so the checks fold away.
+template <typename Root, typename... Nodes, typename... Aliases>
+inline void eval_reverse_topological(
+    Root& root, flat_graph<type_list<Nodes...>, type_list<Aliases...>>) {
+  (check_alias(root, Aliases{}), ...);
+  using nodes_t = std::tuple<Nodes...>;
+  constexpr std::size_t N = sizeof...(Nodes);
+  [&]<std::size_t... I>(std::index_sequence<I...>) {
+    (eval_node(root, std::tuple_element_t<N - 1 - I, nodes_t>{}), ...);
+  }(std::make_index_sequence<N>{});
 }
 
 
@@ -255,8 +459,11 @@ template <typename Expr>
 inline void grad(Expr&& z) {
   adjoint(z) = 1.0;
 //  std::cout << "type: " << type_name<decltype(z)>() << "\n";
-  auto nodes = collect_bfs(z);
-  eval_breadthwise(nodes);
+  if constexpr (is_expr_v<std::decay_t<Expr>>) {
+    using graph_t = decltype(post_order(node_entry<std::decay_t<Expr>, true>{},
+                                        flat_graph<type_list<>, type_list<>>{}));
+    eval_reverse_topological(z, graph_t{});
+  }
 }
 
 static void sct_bench(benchmark::State& state) {
@@ -275,3 +482,77 @@ static void sct_bench(benchmark::State& state) {
 
 
 BENCHMARK(sct_bench);
+
+// a = x * y feeds log(a), b and z, so it is reached along paths of length
+// one, two and three.
+static void sct_dag_bench(benchmark::State& state) {
+    for (auto _ : state) {
+      var x(2.0);
+      var y(4.0);
+      benchmark::DoNotOptimize(x);
+      benchmark::DoNotOptimize(y);
+      auto a = x * y;
+      auto b = log(a) * a;
+      auto z = b + a;
+      grad(z);
+      benchmark::DoNotOptimize(z);
+      benchmark::DoNotOptimize(x.adj());
+      benchmark::DoNotOptimize(y.adj());
+    }
+}
+BENCHMARK(sct_dag_bench);
+
+// Each level uses the one before it twice, so the graph has 2^16 paths from
+// z down to x but only 16 nodes, and the flattened graph has 16 entries.
+static void sct_shared_chain_bench(benchmark::State& state) {
+    for (auto _ : state) {
+      var x(1.0001);
+      benchmark::DoNotOptimize(x);
+      auto a1 = x * x;
+      auto a2 = a1 * a1;
+      auto a3 = a2 * a2;
+      auto a4 = a3 * a3;
+      auto a5 = a4 * a4;
+      auto a6 = a5 * a5;
+      auto a7 = a6 * a6;
+      auto a8 = a7 * a7;
+      auto a9 = a8 * a8;
+      auto a10 = a9 * a9;
+      auto a11 = a10 * a10;
+      auto a12 = a11 * a11;
+      auto a13 = a12 * a12;
+      auto a14 = a13 * a13;
+      auto a15 = a14 * a14;
+      auto z = a15 * a15;
+      grad(z);
+      benchmark::DoNotOptimize(z);
+      benchmark::DoNotOptimize(x.adj());
+    }
+}
+BENCHMARK(sct_shared_chain_bench);
+
+// dot(x, y) * sum(x) + norm(y) over fixed size inputs.
+template <typename Vector, std::size_t N>
+static void sct_fixed_vector_bench(benchmark::State& state) {
+    for (auto _ : state) {
+      Vector x;
+      Vector y;
+      for (std::size_t i = 0; i < N; ++i) {
+        x[i] = var(0.5 + 0.01 * i);
+        y[i] = var(1.0 - 0.01 * i);
+      }
+      benchmark::DoNotOptimize(x);
+      benchmark::DoNotOptimize(y);
+      auto z = dot(x, y) * sum(x) + norm(y);
+      grad(z);
+      benchmark::DoNotOptimize(z);
+      benchmark::DoNotOptimize(x);
+      benchmark::DoNotOptimize(y);
+    }
+}
+BENCHMARK(sct_fixed_vector_bench<std::array<var, 4>, 4>);
+BENCHMARK(sct_fixed_vector_bench<std::array<var, 16>, 16>);
+BENCHMARK(sct_fixed_vector_bench<std::array<var, 64>, 64>);
+BENCHMARK(sct_fixed_vector_bench<Eigen::Matrix<var, 4, 1>, 4>);
+BENCHMARK(sct_fixed_vector_bench<Eigen::Matrix<var, 16, 1>, 16>);
+BENCHMARK(sct_fixed_vector_bench<Eigen::Matrix<var, 64, 1>, 64>);
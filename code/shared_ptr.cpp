@@ -10,6 +10,11 @@
 #include <stdexcept>
 #include <vector>
 #include <ranges> // For std::views::reverse
+#include <cstdlib>
+#include <cxxabi.h>
+#include <map>
+#include <string>
+#include <typeinfo>
 #include <benchmark/benchmark.h>
 
 struct var_impl {
@@ -179,15 +184,34 @@ void grad(var z) noexcept {
   }
 }
 
+// Tape statistics as benchmark counters, taken while the tape still holds
+// the last gradient. Every node is its own heap allocation here.
+static void report_tape_stats(benchmark::State& state) {
+  std::map<std::string, std::size_t> by_type;
+  for (auto&& x : var_vec) {
+    int status = 0;
+    char* name = abi::__cxa_demangle(typeid(*x).name(), nullptr, nullptr, &status);
+    ++by_type[status == 0 ? name : typeid(*x).name()];
+    std::free(name);
+  }
+  state.counters["nodes"] = var_vec.size();
+  state.counters["var_vec_capacity"] = var_vec.capacity();
+  for (auto&& [name, count] : by_type) {
+    state.counters["n:" + name] = count;
+  }
+}
+
 static void shared_ptr_bench(benchmark::State& state) {
     for (auto _ : state) {
+      var_vec.clear();
       var x(2.0);
       var y(4.0);
       auto z = x * log(y) + log(x * y) * y;
       grad(z);
       benchmark::DoNotOptimize(z);
-      var_vec.clear();
     }
+    report_tape_stats(state);
+    var_vec.clear();
 }
 
 BENCHMARK(shared_ptr_bench);
@@ -0,0 +1,263 @@
+#include <ad_ex/soa_tape.hpp>
+#include <ad_ex/soa_replay.hpp>
+#include <ad_ex/soa_incremental.hpp>
+#include <ad_ex/soa_jacobian.hpp>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+static void soa_bench(benchmark::State& state) {
+    for (auto _ : state) {
+      ad::soa::var x(2.0);
+      ad::soa::var y(4.0);
+      auto z = x * log(y) + log(x * y) * y;
+      ad::soa::grad(z);
+      benchmark::DoNotOptimize(x.adj());
+      benchmark::DoNotOptimize(y.adj());
+      ad::soa::clear_mem();
+    }
+}
+BENCHMARK(soa_bench);
+
+// Same graphs as lambda_graph_bench. bytes_per_op is the tape storage per
+// recorded operation, inputs included.
+static void soa_graph_bench(benchmark::State& state) {
+    const auto reps = state.range(0) / 7;
+    double bytes_per_op = 0;
+    for (auto _ : state) {
+      ad::soa::var x(2.0);
+      ad::soa::var y(4.0);
+      ad::soa::var z(0.0);
+      for (int i = 0; i < reps; ++i) {
+        z += x * log(y) + log(x * y) * y;
+      }
+      ad::soa::grad(z);
+      benchmark::DoNotOptimize(x.adj());
+      auto& t = ad::soa::get_tape();
+      bytes_per_op = static_cast<double>(t.bytes()) / t.size();
+      ad::soa::clear_mem();
+    }
+    state.counters["bytes_per_op"] = bytes_per_op;
+    state.SetItemsProcessed(state.iterations() * reps * 7);
+}
+BENCHMARK(soa_graph_bench)-> RangeMultiplier(10) -> Range(1000, 10000000);
+
+// Records the expression once and replays it for new inputs. Compare to
+// soa_bench, which rebuilds the tape every iteration.
+static void soa_replay_bench(benchmark::State& state) {
+    ad::soa::recorded_function f([](const std::vector<ad::soa::var>& x) {
+      return x[0] * log(x[1]) + log(x[0] * x[1]) * x[1];
+    });
+    std::vector<double> x{2.0, 4.0};
+    std::vector<double> g(2);
+    for (auto _ : state) {
+      x[0] += 1e-6;
+      benchmark::DoNotOptimize(f.gradient(x, g));
+      benchmark::DoNotOptimize(g.data());
+    }
+    state.counters["recordings"] = f.recordings();
+}
+BENCHMARK(soa_replay_bench);
+
+static void soa_replay_graph_bench(benchmark::State& state) {
+    const auto reps = state.range(0) / 7;
+    ad::soa::recorded_function f([reps](const std::vector<ad::soa::var>& x) {
+      ad::soa::var z(0.0);
+      for (int i = 0; i < reps; ++i) {
+        z += x[0] * log(x[1]) + log(x[0] * x[1]) * x[1];
+      }
+      return z;
+    });
+    std::vector<double> x{2.0, 4.0};
+    std::vector<double> g(2);
+    for (auto _ : state) {
+      x[0] += 1e-6;
+      benchmark::DoNotOptimize(f.gradient(x, g));
+      benchmark::DoNotOptimize(g.data());
+    }
+    state.counters["recordings"] = f.recordings();
+    state.SetItemsProcessed(state.iterations() * reps * 7);
+}
+BENCHMARK(soa_replay_graph_bench)-> RangeMultiplier(10) -> Range(1000, 10000000);
+
+// A branch on a var comparison. Moving x across zero every iteration
+// trips the guard and forces a new recording.
+static void soa_replay_branch_bench(benchmark::State& state) {
+    ad::soa::recorded_function f([](const std::vector<ad::soa::var>& x) {
+      if (x[0] > 0.0) {
+        return x[0] * log(x[1]);
+      } else {
+        return -x[0] * log(x[1]);
+      }
+    });
+    const bool flip = state.range(0);
+    std::vector<double> x{2.0, 4.0};
+    std::vector<double> g(2);
+    for (auto _ : state) {
+      if (flip) {
+        x[0] = -x[0];
+      }
+      benchmark::DoNotOptimize(f.gradient(x, g));
+      benchmark::DoNotOptimize(g.data());
+    }
+    state.counters["recordings"] = f.recordings();
+}
+BENCHMARK(soa_replay_branch_bench)-> Arg(0) -> Arg(1);
+
+// Pairwise sum so a changed input only reaches log2(n) additions.
+static ad::soa::var tree_sum(const std::vector<ad::soa::var>& xs,
+                             std::size_t begin, std::size_t end) {
+  if (end - begin == 1) {
+    return xs[begin];
+  }
+  const std::size_t mid = begin + (end - begin) / 2;
+  return tree_sum(xs, begin, mid) + tree_sum(xs, mid, end);
+}
+
+static auto incremental_model(const std::vector<ad::soa::var>& x) {
+  std::vector<ad::soa::var> terms;
+  terms.reserve(x.size());
+  for (auto&& x_i : x) {
+    terms.push_back(log(1.0 + square(x_i)) * x_i + sin(x_i));
+  }
+  return tree_sum(terms, 0, terms.size());
+}
+
+// 16384 inputs, state.range(0) of them change every iteration.
+static void soa_incremental_bench(benchmark::State& state) {
+    const std::size_t n = 1 << 14;
+    const std::size_t k = state.range(0);
+    ad::soa::incremental_function f(incremental_model);
+    std::vector<double> x(n, 0.5);
+    std::vector<std::size_t> changed(k);
+    for (std::size_t i = 0; i < k; ++i) {
+      changed[i] = i * (n / k);
+    }
+    f.gradient(x);
+    for (auto _ : state) {
+      for (auto i : changed) {
+        x[i] += 1e-6;
+      }
+      benchmark::DoNotOptimize(f.update(changed, x));
+      benchmark::DoNotOptimize(f.grad().data());
+    }
+    state.counters["forward_ops"] = f.last_forward_ops();
+    state.counters["reverse_ops"] = f.last_reverse_ops();
+}
+BENCHMARK(soa_incremental_bench)-> RangeMultiplier(8) -> Range(1, 1 << 14);
+
+// Long chain behind a guard, the plain sum otherwise.
+static ad::soa::var guarded_model(const std::vector<ad::soa::var>& x) {
+  if (x[0] > x[1]) {
+    ad::soa::var s = x[2];
+    for (int i = 0; i < 2000; ++i) {
+      s = sin(s) * x[0] + x[1];
+    }
+    return s;
+  }
+  return x[0] + x[1];
+}
+
+// Every iteration flips the guard, which records again, and then updates
+// another input on the new tape. Stops with an error if the gradient of the
+// short branch comes out wrong.
+static void soa_incremental_guard_flip_bench(benchmark::State& state) {
+    ad::soa::incremental_function f(guarded_model);
+    const std::vector<std::size_t> changed_0{0};
+    const std::vector<std::size_t> changed_1{1};
+    const std::vector<std::size_t> changed_2{2};
+    for (auto _ : state) {
+      std::vector<double> x{3.0, 1.0, 0.5};
+      f.gradient(x);
+      x[2] = 0.6;
+      f.update(changed_2, x);
+      x[0] = 0.5;
+      f.update(changed_0, x);
+      x[1] = 2.0;
+      const double fx = f.update(changed_1, x);
+      const auto g = f.grad();
+      if (fx != 2.5 || g[0] != 1.0 || g[1] != 1.0 || g[2] != 0.0) {
+        state.SkipWithError("wrong gradient after a guard flip");
+        break;
+      }
+      benchmark::DoNotOptimize(g.data());
+    }
+}
+BENCHMARK(soa_incremental_guard_flip_bench);
+
+// Full replay of the same model for reference.
+static void soa_incremental_full_bench(benchmark::State& state) {
+    const std::size_t n = 1 << 14;
+    ad::soa::recorded_function f(incremental_model);
+    std::vector<double> x(n, 0.5);
+    std::vector<double> g(n);
+    for (auto _ : state) {
+      x[0] += 1e-6;
+      benchmark::DoNotOptimize(f.gradient(x, g));
+      benchmark::DoNotOptimize(g.data());
+    }
+}
+BENCHMARK(soa_incremental_full_bench);
+
+// A dense m x n system standing in for an ODE right hand side: every
+// output sees every input through the shared s.
+static auto jacobian_model(std::size_t m) {
+  return [m](const std::vector<ad::soa::var>& x) {
+    const std::size_t n = x.size();
+    ad::soa::var s = square(x[0]);
+    for (std::size_t i = 1; i < n; ++i) {
+      s += square(x[i]);
+    }
+    std::vector<ad::soa::var> y;
+    y.reserve(m);
+    for (std::size_t r = 0; r < m; ++r) {
+      y.push_back(exp(-x[r % n]) * s + sin(x[(r + 1) % n]) * x[(r + 2) % n]);
+    }
+    return y;
+  };
+}
+
+// Args are n inputs, m outputs and the sweep mode (0 automatic, 1 forward,
+// 2 reverse).
+static void soa_jacobian_bench(benchmark::State& state) {
+    const std::size_t n = state.range(0);
+    const std::size_t m = state.range(1);
+    const auto mode = static_cast<ad::soa::jacobian_mode>(state.range(2));
+    auto f = jacobian_model(m);
+    std::vector<double> x(n, 0.5);
+    std::vector<double> fx;
+    std::vector<double> J;
+    for (auto _ : state) {
+      ad::soa::jacobian(f, x, fx, J, mode);
+      benchmark::DoNotOptimize(J.data());
+    }
+}
+BENCHMARK(soa_jacobian_bench)
+    -> ArgNames({"n", "m", "mode"})
+    -> ArgsProduct({{8, 256}, {8, 256}, {0, 1, 2}});
+
+// Today's approach: record the function again for every output row.
+static void soa_jacobian_rerecord_bench(benchmark::State& state) {
+    const std::size_t n = state.range(0);
+    const std::size_t m = state.range(1);
+    auto f = jacobian_model(m);
+    std::vector<double> J(m * n);
+    for (auto _ : state) {
+      for (std::size_t r = 0; r < m; ++r) {
+        std::vector<ad::soa::var> x;
+        x.reserve(n);
+        for (std::size_t i = 0; i < n; ++i) {
+          x.emplace_back(0.5);
+        }
+        auto y = f(x);
+        ad::soa::grad(y[r]);
+        for (std::size_t i = 0; i < n; ++i) {
+          J[r * n + i] = x[i].adj();
+        }
+        ad::soa::clear_mem();
+      }
+      benchmark::DoNotOptimize(J.data());
+    }
+}
+BENCHMARK(soa_jacobian_rerecord_bench)
+    -> ArgNames({"n", "m"})
+    -> ArgsProduct({{8, 256}, {8, 256}});